@@ -0,0 +1,121 @@
+/**
+ * @file bench.c
+ * @brief Mesure du coût des insertions et des recherches dans un grand répertoire.
+ *
+ * Remplit un unique répertoire par paliers (1 000, 10 000, 100 000 entrées...)
+ * et affiche, pour chaque palier, le temps moyen d'une insertion (add_dir_entry)
+ * et d'une recherche (find_file_in_dir, cache des noms vidé au préalable pour
+ * mesurer le répertoire lui-même). Avec l'index haché et l'indice de place
+ * libre, ces coûts doivent rester à peu près constants quand le répertoire grossit.
+ *
+ * Avec -b, le répertoire est un répertoire trié (B-arbre, voir dir_btree.c).
+ *
+ * Usage: ./bench [nb_entrees_max] [-b]   (100000 par défaut)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "structure.h"
+#include "inode.h"
+#include "block.h"
+#include "file_operation.h"
+#include "folder_operation.h"
+#include "dcache.h"
+#include "dir_entry.h"
+#include "dir_btree.h"
+#include "load.h"
+
+#define BENCH_LOOKUPS 10000
+
+
+/**
+ * @brief Temps écoulé en nanosecondes (horloge monotone).
+ */
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+
+int main(int argc, char *argv[]) {
+    int max_entries = argc > 1 ? atoi(argv[1]) : 100000;
+    int btree = argc > 2 && strcmp(argv[2], "-b") == 0;
+    if (max_entries < 1) {
+        printf("Usage: %s [nb_entrees_max] [-b]\n", argv[0]);
+        return 1;
+    }
+
+    // Blocs de 4 Ko: assez de place pour les entrées, leurs inodes et l'index
+    int block_size = 4096;
+    long long entry_blocks = (long long)max_entries * DIR_REC_LEN(10) / block_size;
+    long long inode_blocks = (long long)max_entries * sizeof(inode_t) / block_size;
+    long long index_blocks = 8LL * max_entries * sizeof(dir_index_slot_t) / block_size;
+    partition_geometry_t geometry = { block_size, (int)(entry_blocks + inode_blocks + index_blocks + 1024),
+                                      max_entries + 16 };
+    partition_t *part = create_new_partition(&geometry);
+    if (part == NULL) {
+        printf("Erreur: Impossible de créer la partition\n");
+        return 1;
+    }
+
+    int dir = allocate_inode(part);
+    part->inodes[dir].mode = 040755;
+    part->inodes[dir].dir_blocks = 1;
+    part->inodes[dir].direct_blocks[0] = allocate_block(part);
+    dir_block_init(part, block_ptr(part, part->inodes[dir].direct_blocks[0]));
+    if (btree && dir_btree_create(part, dir) != 0) {
+        free_partition(part);
+        return 1;
+    }
+
+    printf("%12s  %14s  %14s\n", "entrees", "insertion (ns)", "recherche (ns)");
+
+    char name[MAX_NAME_LENGTH];
+    int count = 0;
+    srand(42);
+    for (int tier = 1000; count < max_entries; tier *= 10) {
+        if (tier > max_entries) tier = max_entries;
+
+        // Insérer les entrées jusqu'au palier
+        int inserted = tier - count;
+        double start = now_ns();
+        for (; count < tier; count++) {
+            int ino = allocate_inode(part);
+            if (ino == -1) {
+                printf("Erreur: Plus d'inodes disponibles\n");
+                free_partition(part);
+                return 1;
+            }
+            part->inodes[ino].mode = 0100644;
+            part->inodes[ino].links_count = 1;
+            snprintf(name, sizeof(name), "f%d", count);
+            if (add_dir_entry(part, dir, name, ino) != 0) {
+                printf("Erreur: Impossible d'ajouter '%s'\n", name);
+                free_partition(part);
+                return 1;
+            }
+        }
+        double insert_ns = (now_ns() - start) / inserted;
+
+        // Chercher des noms existants tirés au hasard
+        dcache_clear(part);
+        start = now_ns();
+        for (int i = 0; i < BENCH_LOOKUPS; i++) {
+            snprintf(name, sizeof(name), "f%d", rand() % count);
+            if (find_file_in_dir(part, dir, name) == -1) {
+                printf("Erreur: '%s' introuvable\n", name);
+                free_partition(part);
+                return 1;
+            }
+        }
+        double lookup_ns = (now_ns() - start) / BENCH_LOOKUPS;
+
+        printf("%12d  %14.0f  %14.0f\n", count, insert_ns, lookup_ns);
+    }
+
+    free_partition(part);
+    return 0;
+}
@@ -17,20 +17,83 @@
  * 
  * Cette fonction marque un bloc comme libre dans le bitmap des blocs, réinitialise
  * son contenu à zéro, et met à jour le nombre de blocs libres dans le superbloc.
+ * Pendant un lot (block_batch_begin), le bloc est seulement noté dans le lot.
  * 
  * @param part Pointeur vers la partition contenant le bloc à libérer.
- * @param block_num Numéro du bloc à libérer.
+ * @param block_num Numéro logique du bloc à libérer (tel que retourné par allocate_block).
  */
 void free_block(partition_t *part, int block_num) {
-    int byte_index = block_num / 8;
-    int bit_index = block_num % 8;
+    // Pendant un lot, le bloc est seulement noté (voir block_batch_begin)
+    block_batch_t *batch = part->block_batch;
+    if (batch != NULL) {
+        if (batch->count == batch->capacity) {
+            int new_capacity = batch->capacity != 0 ? batch->capacity * 2 : 256;
+            int *blocks = (int *)realloc(batch->blocks, new_capacity * sizeof(int));
+            if (blocks != NULL) {
+                batch->blocks = blocks;
+                batch->capacity = new_capacity;
+            }
+        }
+        if (batch->count < batch->capacity) {
+            batch->blocks[batch->count++] = block_num;
+            return;
+        }
+        // Mémoire insuffisante: libérer ce bloc tout de suite
+    }
+    
+    int phys = block_num + part->first_data_block;
+    int word_index = phys / BITMAP_WORD_BITS;
+    int bit_index = phys % BITMAP_WORD_BITS;
     
     // Marquer le bloc comme libre
-    part->block_bitmap->bitmap[byte_index] &= ~(1 << bit_index);
+    part->block_bitmap[word_index] &= ~(1ULL << bit_index);
     part->superblock->free_blocks_count++;
     
     // Effacer le contenu du bloc
-    memset(part->space->data + block_num * BLOCK_SIZE, 0, BLOCK_SIZE);
+    memset(part->space->data + (size_t)phys * part->block_size, 0, part->block_size);
+}
+
+
+/**
+ * @brief Ouvre un lot de libérations.
+ * 
+ * Jusqu'à block_batch_end, free_block ne touche ni au bitmap ni au contenu des
+ * blocs: il note seulement leurs numéros. Aucun bloc ne doit être alloué
+ * pendant le lot (un bloc noté est encore marqué utilisé).
+ * 
+ * @param part Pointeur vers la partition.
+ * @param batch Lot à remplir, fourni par l'appelant.
+ */
+void block_batch_begin(partition_t *part, block_batch_t *batch) {
+    batch->blocks = NULL;
+    batch->count = 0;
+    batch->capacity = 0;
+    part->block_batch = batch;
+}
+
+
+/**
+ * @brief Ferme le lot de libérations et rend tous ses blocs au bitmap.
+ * 
+ * Les blocs ne sont pas remis à zéro: allocate_block et allocate_extent le
+ * font déjà à l'allocation.
+ * 
+ * @param part Pointeur vers la partition dont le lot est ouvert.
+ */
+void block_batch_end(partition_t *part) {
+    block_batch_t *batch = part->block_batch;
+    part->block_batch = NULL;
+    
+    for (int i = 0; i < batch->count; i++) {
+        int phys = batch->blocks[i] + part->first_data_block;
+        part->block_bitmap[phys / BITMAP_WORD_BITS] &= ~(1ULL << (phys % BITMAP_WORD_BITS));
+    }
+    part->superblock->free_blocks_count += batch->count;
+    
+    free(batch->blocks);
+    batch->blocks = NULL;
+    batch->count = 0;
+    batch->capacity = 0;
 }
 
 
@@ -39,28 +102,132 @@ void free_block(partition_t *part, int block_num) {
  * 
  * Cette fonction recherche un bloc libre dans la partition, le marque comme
  * utilisé dans le bitmap des blocs, initialise son contenu à zéro, et met à jour
- * le nombre de blocs libres dans le superbloc. La fonction commence la recherche
- * à partir de l'offset réservé aux utilisateurs.
+ * le nombre de blocs libres dans le superbloc.
+ * 
+ * La recherche se fait mot de 64 bits par mot: les mots entièrement occupés sont
+ * sautés, et le premier bit libre d'un mot est trouvé avec __builtin_ctzll. Elle
+ * reprend là où la dernière allocation s'est arrêtée (next-fit, curseur
+ * part->next_free_block) et fait le tour du bitmap une seule fois.
  * 
  * @param part Pointeur vers la partition où allouer le bloc.
  * @return int Le numéro logique du bloc alloué, ou -1 si aucun bloc libre n'est
  *         disponible.
  */
 int allocate_block(partition_t *part) {
-    // Start search from USERSAPCE_OFSET but return logical block numbers
-    for (int i = USERSAPCE_OFSET; i < MAX_BLOCKS; i++) {
-        int byte_index = i / 8;
-        int bit_index = i % 8;
-        if (!(part->block_bitmap->bitmap[byte_index] & (1 << bit_index))) {
-            part->block_bitmap->bitmap[byte_index] |= (1 << bit_index);
-            part->superblock->free_blocks_count--;
-            
-            // Initialize block to zero
-            memset(part->space->data + i * BLOCK_SIZE, 0, BLOCK_SIZE);
-            
-            return i - USERSAPCE_OFSET;  // Return logical block number
+    int start = part->next_free_block;
+    if (start < part->first_data_block || start >= part->num_blocks) {
+        start = part->first_data_block;
+    }
+    int num_words = BITMAP_WORDS(part->num_blocks);
+    
+    int first_word = start / BITMAP_WORD_BITS;
+    int start_bit = start % BITMAP_WORD_BITS;
+    
+    // num_words + 1 passes: le premier mot est revisité à la fin pour
+    // les bits situés avant le curseur
+    for (int n = 0; n <= num_words; n++) {
+        int w = (first_word + n) % num_words;
+        uint64_t free_bits = ~part->block_bitmap[w];
+        
+        if (n == 0) {
+            free_bits &= ~0ULL << start_bit;
+        } else if (n == num_words) {
+            free_bits &= start_bit ? (~0ULL >> (BITMAP_WORD_BITS - start_bit)) : 0;
         }
+        if (free_bits == 0) continue;  // Mot plein
+        
+        int i = w * BITMAP_WORD_BITS + __builtin_ctzll(free_bits);
+        if (i >= part->num_blocks) continue;  // Bits de bourrage du dernier mot
+        
+        part->block_bitmap[w] |= 1ULL << (i % BITMAP_WORD_BITS);
+        part->superblock->free_blocks_count--;
+        part->next_free_block = i + 1;
+        
+        // Initialize block to zero
+        memset(part->space->data + (size_t)i * part->block_size, 0, part->block_size);
+        
+        return i - part->first_data_block;  // Return logical block number
     }
     return -1;
 }
 
+
+/**
+ * @brief Alloue une suite de blocs contigus (extent) dans la partition.
+ * 
+ * Parcourt le bitmap une fois, à partir du curseur next-fit, en cherchant une
+ * suite d'au moins @p wanted blocs libres consécutifs. Les mots vides comptent
+ * pour 64 blocs d'un coup et les mots pleins coupent la suite courante. Si
+ * aucune suite assez longue n'existe, la plus longue trouvée est allouée.
+ * Les blocs alloués sont marqués utilisés et remis à zéro.
+ * 
+ * @param part Pointeur vers la partition où allouer les blocs.
+ * @param wanted Nombre de blocs souhaités (>= 1).
+ * @param length Reçoit le nombre de blocs effectivement alloués (<= wanted).
+ * @return int Le numéro logique du premier bloc, ou -1 si la partition est pleine.
+ */
+int allocate_extent(partition_t *part, int wanted, int *length) {
+    int num_words = BITMAP_WORDS(part->num_blocks);
+    int start = part->next_free_block;
+    if (start < part->first_data_block || start >= part->num_blocks) {
+        start = part->first_data_block;
+    }
+    
+    int best_start = -1, best_len = 0;
+    int run_start = -1, run_len = 0;
+    
+    // Deux tours au plus: de start à la fin, puis du début de l'espace à start
+    for (int pass = 0; pass < 2 && best_len < wanted; pass++) {
+        int from = (pass == 0) ? start : part->first_data_block;
+        int to = (pass == 0) ? part->num_blocks : start;
+        run_start = -1;
+        run_len = 0;
+        
+        int i = from;
+        while (i < to && best_len < wanted) {
+            int w = i / BITMAP_WORD_BITS;
+            uint64_t word = part->block_bitmap[w];
+            
+            if (i % BITMAP_WORD_BITS == 0 && w < num_words && i + BITMAP_WORD_BITS <= to && (word == 0 || ~word == 0)) {
+                if (word == 0) {
+                    // Mot entièrement libre: prolonge la suite de 64 blocs
+                    if (run_start == -1) run_start = i;
+                    run_len += BITMAP_WORD_BITS;
+                } else {
+                    run_start = -1;  // Mot plein: la suite est interrompue
+                    run_len = 0;
+                }
+                i += BITMAP_WORD_BITS;
+            } else {
+                if (word & (1ULL << (i % BITMAP_WORD_BITS))) {
+                    run_start = -1;
+                    run_len = 0;
+                } else {
+                    if (run_start == -1) run_start = i;
+                    run_len++;
+                }
+                i++;
+            }
+            
+            if (run_len > best_len) {
+                best_start = run_start;
+                best_len = run_len;
+            }
+        }
+    }
+    
+    if (best_start == -1) return -1;
+    if (best_len > wanted) best_len = wanted;
+    
+    // Marquer la suite comme utilisée
+    for (int i = best_start; i < best_start + best_len; i++) {
+        part->block_bitmap[i / BITMAP_WORD_BITS] |= 1ULL << (i % BITMAP_WORD_BITS);
+    }
+    part->superblock->free_blocks_count -= best_len;
+    part->next_free_block = best_start + best_len;
+    
+    memset(part->space->data + (size_t)best_start * part->block_size, 0, (size_t)best_len * part->block_size);
+    
+    *length = best_len;
+    return best_start - part->first_data_block;  // Numéro logique
+}
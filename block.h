@@ -9,7 +9,17 @@
 #include "structure.h"
 #include "load.h"
 
+/**
+ * @brief Adresse du contenu d'un bloc logique dans l'espace de la partition.
+ */
+static inline char *block_ptr(partition_t *part, int block_num) {
+    return part->space->data + (block_num + part->first_data_block) * part->block_size;
+}
+
 int allocate_block(partition_t *part);
 void free_block(partition_t *part, int block_num);
+void block_batch_begin(partition_t *part, block_batch_t *batch);
+void block_batch_end(partition_t *part);
+int allocate_extent(partition_t *part, int wanted, int *length);
 
 #endif // BLOCK_H
\ No newline at end of file
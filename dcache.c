@@ -0,0 +1,268 @@
+/**
+ * @file dcache.c
+ * @brief Cache des noms (dentry cache) pour la résolution des chemins.
+ *
+ * Mémorise le résultat des recherches (répertoire, nom) -> inode faites par
+ * find_file_in_dir, y compris les échecs (entrées négatives), pour qu'un même
+ * chemin résolu plusieurs fois ne relise pas les blocs des répertoires. Le cache
+ * n'est pas sauvegardé avec la partition: il est vidé au chargement.
+ *
+ * L'invalidation est précise: add_dir_entry et remove_dir_entry oublient le nom
+ * modifié, et la libération d'un répertoire oublie tous les noms qu'il contenait
+ * (son numéro d'inode peut être réutilisé).
+ *
+ * Le même module garde, pour chaque répertoire, son parent et la position de
+ * son entrée dans ce parent (dir_parents), ce qui permet de reconstruire le chemin courant en
+ * remontant une simple chaîne de pointeurs.
+ *
+ * Il garde aussi l'inode désigné par chaque lien symbolique (symlinks), pour que
+ * namei ne relise pas la cible ni ne reparcoure son chemin à chaque traversée.
+ * Une cible dépend de tous les répertoires de son chemin et de leurs droits:
+ * plutôt que de suivre ces dépendances, chaque suppression ou remplacement de
+ * nom et chaque changement de droits incrémente la génération de la partition,
+ * qui invalide d'un coup toutes les cibles. Un ajout de nom ne peut pas changer
+ * une cible déjà résolue: il n'invalide rien.
+ *
+ * Enfin, pour un répertoire dont l'index haché n'a pas pu être construit
+ * (partition pleine), dir_index_retry note le nombre d'entrées à atteindre
+ * avant un nouvel essai (voir dir_index_insert).
+ */
+
+#include "dcache.h"
+
+
+/**
+ * @brief Case du cache associée à (parent, name).
+ */
+static dentry_t *dcache_slot(partition_t *part, int parent, const char *name) {
+    uint32_t hash = dir_hash(name) ^ ((uint32_t)parent * 2654435761u);
+    return &part->dcache[hash & (DCACHE_SIZE - 1)];
+}
+
+
+/**
+ * @brief Alloue le cache des noms, des parents et des liens d'une partition.
+ *
+ * Le cache des parents et celui des liens ont une case par inode: il faut le réallouer quand le
+ * nombre d'inodes change (chargement d'une autre partition).
+ *
+ * @param part Pointeur vers la partition (géométrie déjà positionnée).
+ * @return 0 en cas de succès, -1 si la mémoire manque.
+ */
+int dcache_init(partition_t *part) {
+    part->dcache = (dentry_t*)malloc(DCACHE_SIZE * sizeof(dentry_t));
+    part->dir_parents = (dir_parent_t*)malloc((size_t)part->num_inodes * sizeof(dir_parent_t));
+    part->symlinks = (symlink_cache_t*)malloc((size_t)part->num_inodes * sizeof(symlink_cache_t));
+    part->dir_index_retry = (int*)malloc((size_t)part->num_inodes * sizeof(int));
+    if (part->dcache == NULL || part->dir_parents == NULL || part->symlinks == NULL || part->dir_index_retry == NULL) {
+        dcache_destroy(part);
+        return -1;
+    }
+    dcache_clear(part);
+    return 0;
+}
+
+
+/**
+ * @brief Libère le cache des noms, des parents et des liens d'une partition.
+ *
+ * @param part Pointeur vers la partition.
+ */
+void dcache_destroy(partition_t *part) {
+    free(part->dcache);
+    free(part->dir_parents);
+    free(part->symlinks);
+    free(part->dir_index_retry);
+    part->dcache = NULL;
+    part->dir_parents = NULL;
+    part->symlinks = NULL;
+    part->dir_index_retry = NULL;
+}
+
+
+/**
+ * @brief Vide le cache des noms, des parents et des liens.
+ *
+ * @param part Pointeur vers la partition.
+ */
+void dcache_clear(partition_t *part) {
+    for (int i = 0; i < DCACHE_SIZE; i++) {
+        part->dcache[i].parent = -1;
+    }
+    for (int i = 0; i < part->num_inodes; i++) {
+        part->dir_parents[i].parent = -1;
+        part->symlinks[i].dir = -1;
+        part->dir_index_retry[i] = 0;
+    }
+}
+
+
+/**
+ * @brief Cherche (parent, name) dans le cache.
+ *
+ * @param part Pointeur vers la partition.
+ * @param parent Inode du répertoire.
+ * @param name Nom cherché.
+ * @param inode_num Reçoit l'inode en cache, -1 pour une entrée négative.
+ * @return 1 si le cache connaît la réponse, 0 sinon.
+ */
+int dcache_lookup(partition_t *part, int parent, const char *name, int *inode_num) {
+    dentry_t *d = dcache_slot(part, parent, name);
+    if (d->parent != parent || strcmp(d->name, name) != 0) return 0;
+    *inode_num = d->inode_num;
+    return 1;
+}
+
+
+/**
+ * @brief Enregistre le résultat d'une recherche, en remplaçant l'occupant de la case.
+ *
+ * Les noms trop longs pour une entrée de répertoire ne sont pas mis en cache.
+ *
+ * @param part Pointeur vers la partition.
+ * @param parent Inode du répertoire.
+ * @param name Nom cherché.
+ * @param inode_num Inode trouvé, ou -1 si le nom est absent.
+ */
+void dcache_insert(partition_t *part, int parent, const char *name, int inode_num) {
+    if (strlen(name) >= MAX_NAME_LENGTH) return;
+
+    dentry_t *d = dcache_slot(part, parent, name);
+    d->parent = parent;
+    d->inode_num = inode_num;
+    strcpy(d->name, name);
+}
+
+
+/**
+ * @brief Oublie (parent, name) après une modification du répertoire.
+ *
+ * @param part Pointeur vers la partition.
+ * @param parent Inode du répertoire modifié.
+ * @param name Nom ajouté ou supprimé.
+ */
+void dcache_invalidate(partition_t *part, int parent, const char *name) {
+    dentry_t *d = dcache_slot(part, parent, name);
+    if (d->parent == parent && strcmp(d->name, name) == 0) {
+        d->parent = -1;
+    }
+}
+
+
+/**
+ * @brief Oublie tous les noms d'un répertoire qui est libéré.
+ *
+ * @param part Pointeur vers la partition.
+ * @param dir_inode Inode du répertoire libéré.
+ */
+void dcache_forget_dir(partition_t *part, int dir_inode) {
+    symlink_cache_invalidate(part);
+    for (int i = 0; i < DCACHE_SIZE; i++) {
+        if (part->dcache[i].parent == dir_inode) {
+            part->dcache[i].parent = -1;
+        }
+    }
+    part->dir_parents[dir_inode].parent = -1;
+    part->dir_index_retry[dir_inode] = 0;
+}
+
+
+/**
+ * @brief Oublie d'un coup les noms et le parent d'un ensemble d'inodes libérés.
+ *
+ * Un seul balayage du cache au lieu d'un par répertoire (voir dcache_forget_dir):
+ * une case dont le répertoire est libre (inode remis à zéro) est vidée.
+ *
+ * @param part Pointeur vers la partition.
+ * @param inodes Inodes libérés (déjà remis à zéro par free_inodes).
+ * @param count Nombre d'inodes.
+ */
+void dcache_forget_freed(partition_t *part, const int *inodes, int count) {
+    symlink_cache_invalidate(part);
+    for (int i = 0; i < count; i++) {
+        part->dir_parents[inodes[i]].parent = -1;
+        part->dir_index_retry[inodes[i]] = 0;
+    }
+    for (int i = 0; i < DCACHE_SIZE; i++) {
+        int parent = part->dcache[i].parent;
+        if (parent != -1 && part->inodes[parent].mode == 0) {
+            part->dcache[i].parent = -1;
+        }
+    }
+}
+
+
+/**
+ * @brief Mémorise le parent d'un répertoire et la position de son entrée.
+ *
+ * Les entrées ne bougent pas dans un répertoire (voir dir_entry_t): le nom se
+ * relit à cette position.
+ *
+ * @param part Pointeur vers la partition.
+ * @param dir_inode Inode du répertoire.
+ * @param parent Inode du répertoire qui le contient.
+ * @param pos Position de l'entrée de dir_inode dans parent.
+ */
+void dir_parent_set(partition_t *part, int dir_inode, int parent, int pos) {
+    part->dir_parents[dir_inode].parent = parent;
+    part->dir_parents[dir_inode].pos = pos;
+}
+
+
+/**
+ * @brief Oublie le parent d'un répertoire si son entrée (parent, pos) disparaît.
+ *
+ * @param part Pointeur vers la partition.
+ * @param dir_inode Inode du répertoire.
+ * @param parent Répertoire dont l'entrée est supprimée.
+ * @param pos Position de l'entrée supprimée.
+ */
+void dir_parent_forget(partition_t *part, int dir_inode, int parent, int pos) {
+    dir_parent_t *p = &part->dir_parents[dir_inode];
+    if (p->parent == parent && p->pos == pos) {
+        p->parent = -1;
+    }
+}
+
+
+/**
+ * @brief Cherche la cible résolue d'un lien symbolique.
+ *
+ * @param part Pointeur vers la partition.
+ * @param link_inode Inode du lien.
+ * @param dir Répertoire qui contient le lien (point de départ d'une cible relative).
+ * @param target Reçoit l'inode désigné par la cible.
+ * @return 1 si la cible en cache est encore valable, 0 sinon.
+ */
+int symlink_cache_lookup(partition_t *part, int link_inode, int dir, int *target) {
+    symlink_cache_t *c = &part->symlinks[link_inode];
+    if (c->dir != dir || c->generation != part->generation) return 0;
+    *target = c->target;
+    return 1;
+}
+
+
+/**
+ * @brief Mémorise la cible résolue d'un lien symbolique.
+ *
+ * @param part Pointeur vers la partition.
+ * @param link_inode Inode du lien.
+ * @param dir Répertoire d'où la cible a été résolue.
+ * @param target Inode désigné par la cible.
+ */
+void symlink_cache_insert(partition_t *part, int link_inode, int dir, int target) {
+    symlink_cache_t *c = &part->symlinks[link_inode];
+    c->dir = dir;
+    c->target = target;
+    c->generation = part->generation;
+}
+
+
+/**
+ * @brief Invalide toutes les cibles en cache (noms, droits ou utilisateur modifiés).
+ *
+ * @param part Pointeur vers la partition.
+ */
+void symlink_cache_invalidate(partition_t *part) {
+    part->generation++;
+}
@@ -0,0 +1,23 @@
+#ifndef DCACHE_H
+#define DCACHE_H
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "structure.h"
+#include "dir_index.h"
+int dcache_init(partition_t *part);
+void dcache_destroy(partition_t *part);
+void dcache_clear(partition_t *part);
+int dcache_lookup(partition_t *part, int parent, const char *name, int *inode_num);
+void dcache_insert(partition_t *part, int parent, const char *name, int inode_num);
+void dcache_invalidate(partition_t *part, int parent, const char *name);
+void dcache_forget_dir(partition_t *part, int dir_inode);
+void dcache_forget_freed(partition_t *part, const int *inodes, int count);
+void dir_parent_set(partition_t *part, int dir_inode, int parent, int pos);
+void dir_parent_forget(partition_t *part, int dir_inode, int parent, int pos);
+int symlink_cache_lookup(partition_t *part, int link_inode, int dir, int *target);
+void symlink_cache_insert(partition_t *part, int link_inode, int dir, int target);
+void symlink_cache_invalidate(partition_t *part);
+
+#endif // DCACHE_H
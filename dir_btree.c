@@ -0,0 +1,503 @@
+/**
+ * @file dir_btree.c
+ * @brief Répertoires triés: index en B-arbre ordonné par nom.
+ *
+ * Un répertoire créé avec mkdir -b (INODE_FL_DIR_BTREE) remplace son index
+ * haché par un B+arbre dont les feuilles associent chaque nom à la position de
+ * son entrée. Les entrées elles-mêmes restent dans les blocs du répertoire
+ * (voir dir_entry_t): seul l'index change. Une recherche coûte O(log n) et les
+ * feuilles, chaînées dans l'ordre des noms, permettent de parcourir le
+ * répertoire trié ou seulement les noms d'un préfixe (dir_btree_scan).
+ *
+ * Les nœuds ne sont pas fusionnés quand des entrées sont retirées: une feuille
+ * peut rester vide, et les séparateurs restent des bornes valides puisqu'ils
+ * sont des copies des noms. L'arbre est libéré avec le répertoire.
+ */
+
+#include "dir_btree.h"
+#include "dir_index.h"
+
+
+/**
+ * @brief Nœud stocké dans un bloc logique.
+ */
+static dir_btree_node_t *btree_node(partition_t *part, int block) {
+    return (dir_btree_node_t *)block_ptr(part, block);
+}
+
+
+/**
+ * @brief Clé d'indice i d'un nœud.
+ */
+static dir_btree_key_t *node_key(dir_btree_node_t *node, int i) {
+    return (dir_btree_key_t *)((char *)node + node->slots[i]);
+}
+
+
+/**
+ * @brief Compare une clé à un nom de len octets (même ordre que strcmp).
+ */
+static int key_cmp(const dir_btree_key_t *key, const char *name, int len) {
+    int n = key->len < len ? key->len : len;
+    int c = memcmp(key->name, name, n);
+    if (c != 0) return c;
+    return key->len - len;
+}
+
+
+/**
+ * @brief Indice de la première clé >= name.
+ */
+static int node_lower_bound(dir_btree_node_t *node, const char *name, int len) {
+    int lo = 0, hi = node->count;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (key_cmp(node_key(node, mid), name, len) < 0) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+
+/**
+ * @brief Indice de la première clé > name.
+ */
+static int node_upper_bound(dir_btree_node_t *node, const char *name, int len) {
+    int lo = 0, hi = node->count;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (key_cmp(node_key(node, mid), name, len) <= 0) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+
+/**
+ * @brief Enfant d'un nœud interne qui couvre name.
+ */
+static int node_child(dir_btree_node_t *node, const char *name, int len) {
+    int i = node_upper_bound(node, name, len);
+    return i == 0 ? node->child0 : node_key(node, i - 1)->value;
+}
+
+
+/**
+ * @brief Feuille qui couvre name.
+ */
+static dir_btree_node_t *find_leaf(partition_t *part, int dir_inode, const char *name, int len) {
+    dir_btree_node_t *node = btree_node(part, part->inodes[dir_inode].dir_index_block);
+    while (!node->leaf) {
+        node = btree_node(part, node_child(node, name, len));
+    }
+    return node;
+}
+
+
+/**
+ * @brief Vide un nœud.
+ */
+static void node_init(partition_t *part, dir_btree_node_t *node, int leaf) {
+    node->leaf = leaf;
+    node->count = 0;
+    node->heap = part->block_size;
+    node->next = -1;
+    node->child0 = -1;
+}
+
+
+/**
+ * @brief Ajoute une clé après les autres (l'appelant garantit la place et l'ordre).
+ */
+static void node_append(dir_btree_node_t *node, const char *name, int len, int value) {
+    node->heap -= DIR_BTREE_KEY_SIZE(len);
+    dir_btree_key_t *key = (dir_btree_key_t *)((char *)node + node->heap);
+    key->value = value;
+    key->len = len;
+    memcpy(key->name, name, len);
+    node->slots[node->count++] = node->heap;
+}
+
+
+/**
+ * @brief Insère une clé à l'indice idx, en tassant les clés si la place est fragmentée.
+ *
+ * @return 0 en cas de succès, -1 si le nœud est plein (ou faute de mémoire pour le tasser).
+ */
+static int node_insert(partition_t *part, dir_btree_node_t *node, int idx, const char *name, int len, int value) {
+    int need = DIR_BTREE_KEY_SIZE(len) + sizeof(uint16_t);
+    int slots_end = sizeof(dir_btree_node_t) + node->count * sizeof(uint16_t);
+
+    if (node->heap - slots_end < need) {
+        // Les clés retirées laissent des trous: tasser si cela suffit
+        int live = 0;
+        for (int i = 0; i < node->count; i++) live += DIR_BTREE_KEY_SIZE(node_key(node, i)->len);
+        if (part->block_size - slots_end - live < need) return -1;
+
+        char *copy = (char *)malloc(part->block_size);
+        if (copy == NULL) return -1;
+        memcpy(copy, node, part->block_size);
+        dir_btree_node_t *old = (dir_btree_node_t *)copy;
+        node->count = 0;
+        node->heap = part->block_size;
+        for (int i = 0; i < old->count; i++) {
+            dir_btree_key_t *key = node_key(old, i);
+            node_append(node, key->name, key->len, key->value);
+        }
+        free(copy);
+    }
+
+    node->heap -= DIR_BTREE_KEY_SIZE(len);
+    dir_btree_key_t *key = (dir_btree_key_t *)((char *)node + node->heap);
+    key->value = value;
+    key->len = len;
+    memcpy(key->name, name, len);
+    memmove(&node->slots[idx + 1], &node->slots[idx], (node->count - idx) * sizeof(uint16_t));
+    node->slots[idx] = node->heap;
+    node->count++;
+    return 0;
+}
+
+
+/**
+ * @brief Coupe en deux un nœud plein en y insérant une clé.
+ *
+ * Les clés sont réparties en deux moitiés de tailles voisines; le nœud garde
+ * la moitié basse et un nouveau bloc reçoit la moitié haute. Pour une feuille,
+ * le séparateur est le premier nom de la moitié haute; pour un nœud interne,
+ * la clé du milieu remonte et son enfant devient child0 de la moitié haute.
+ *
+ * @param sep Reçoit le séparateur à insérer dans le parent (MAX_NAME_LENGTH octets).
+ * @param sep_len Reçoit sa longueur.
+ * @param right Reçoit le bloc de la moitié haute.
+ * @return 0 en cas de succès, -1 si les blocs ou la mémoire manquent (nœud inchangé).
+ */
+static int node_split(partition_t *part, int node_block, int idx, const char *name, int len, int value,
+                      char *sep, int *sep_len, int *right) {
+    dir_btree_node_t *node = btree_node(part, node_block);
+    int n = node->count + 1;
+    int new_key[DIR_BTREE_KEY_SIZE(MAX_NAME_LENGTH) / sizeof(int)];
+    char *copy = (char *)malloc(part->block_size);
+    dir_btree_key_t **keys = (dir_btree_key_t **)malloc(n * sizeof(dir_btree_key_t *));
+    int right_block = allocate_block(part);
+    if (copy == NULL || keys == NULL || right_block == -1) {
+        if (right_block != -1) free_block(part, right_block);
+        free(copy);
+        free(keys);
+        return -1;
+    }
+
+    // Clés dans l'ordre, la nouvelle à l'indice idx
+    memcpy(copy, node, part->block_size);
+    dir_btree_node_t *old = (dir_btree_node_t *)copy;
+    dir_btree_key_t *key = (dir_btree_key_t *)new_key;
+    key->value = value;
+    key->len = len;
+    memcpy(key->name, name, len);
+    int total = 0;
+    for (int i = 0; i < n; i++) {
+        keys[i] = i < idx ? node_key(old, i) : i == idx ? key : node_key(old, i - 1);
+        total += DIR_BTREE_KEY_SIZE(keys[i]->len) + sizeof(uint16_t);
+    }
+    int m = 0;
+    for (int cum = 0; m < n; m++) {
+        cum += DIR_BTREE_KEY_SIZE(keys[m]->len) + sizeof(uint16_t);
+        if (2 * cum >= total) break;
+    }
+
+    dir_btree_node_t *right_node = btree_node(part, right_block);
+    node_init(part, node, old->leaf);
+    node_init(part, right_node, old->leaf);
+    if (old->leaf) {
+        // Feuilles: [0, m] à gauche, (m, n) à droite
+        for (int i = 0; i <= m; i++) node_append(node, keys[i]->name, keys[i]->len, keys[i]->value);
+        for (int i = m + 1; i < n; i++) node_append(right_node, keys[i]->name, keys[i]->len, keys[i]->value);
+        right_node->next = old->next;
+        node->next = right_block;
+        *sep_len = keys[m + 1]->len;
+        memcpy(sep, keys[m + 1]->name, *sep_len);
+    } else {
+        // Nœuds internes: [0, m) à gauche, m remonte, (m, n) à droite
+        node->child0 = old->child0;
+        for (int i = 0; i < m; i++) node_append(node, keys[i]->name, keys[i]->len, keys[i]->value);
+        right_node->child0 = keys[m]->value;
+        for (int i = m + 1; i < n; i++) node_append(right_node, keys[i]->name, keys[i]->len, keys[i]->value);
+        *sep_len = keys[m]->len;
+        memcpy(sep, keys[m]->name, *sep_len);
+    }
+    *right = right_block;
+
+    free(keys);
+    free(copy);
+    return 0;
+}
+
+
+/**
+ * @brief Libère un nœud et tous ses descendants.
+ */
+static void free_subtree(partition_t *part, int block) {
+    dir_btree_node_t *node = btree_node(part, block);
+    if (!node->leaf) {
+        free_subtree(part, node->child0);
+        for (int i = 0; i < node->count; i++) {
+            free_subtree(part, node_key(node, i)->value);
+        }
+    }
+    free_block(part, block);
+}
+
+
+/**
+ * @brief Insère un nom dans le sous-arbre d'un nœud.
+ *
+ * @return 0 si la clé a été insérée, 1 si le nœud a été coupé (le séparateur
+ *         et le nouveau bloc sont à insérer dans le parent), -1 en cas d'erreur.
+ */
+static int insert_rec(partition_t *part, int node_block, const char *name, int len, int value,
+                      char *sep, int *sep_len, int *right) {
+    dir_btree_node_t *node = btree_node(part, node_block);
+    char child_sep[MAX_NAME_LENGTH];
+    int child_right = -1;
+
+    if (!node->leaf) {
+        int child_sep_len;
+        int result = insert_rec(part, node_child(node, name, len), name, len, value,
+                                child_sep, &child_sep_len, &child_right);
+        if (result != 1) return result;
+        // L'enfant a été coupé: son séparateur remonte dans ce nœud
+        name = child_sep;
+        len = child_sep_len;
+        value = child_right;
+    } else {
+        int i = node_lower_bound(node, name, len);
+        if (i < node->count && key_cmp(node_key(node, i), name, len) == 0) {
+            node_key(node, i)->value = value;
+            return 0;
+        }
+    }
+
+    int idx = node->leaf ? node_lower_bound(node, name, len) : node_upper_bound(node, name, len);
+    if (node_insert(part, node, idx, name, len, value) == 0) return 0;
+    if (node_split(part, node_block, idx, name, len, value, sep, sep_len, right) == 0) return 1;
+
+    // La moitié haute de l'enfant n'est plus reliée à l'arbre
+    if (child_right != -1) free_subtree(part, child_right);
+    return -1;
+}
+
+
+/**
+ * @brief Longueur maximale d'un nom dans un répertoire trié.
+ *
+ * Un nœud doit pouvoir contenir au moins quatre clés pour que ses deux
+ * moitiés tiennent après une coupure: avec de petits blocs, la limite est
+ * plus basse que MAX_NAME_LENGTH - 1.
+ *
+ * @param part Pointeur vers la partition.
+ * @return Le nombre maximal d'octets d'un nom.
+ */
+int dir_btree_max_name(partition_t *part) {
+    int per_key = (part->block_size - (int)sizeof(dir_btree_node_t)) / 4 - (int)sizeof(uint16_t);
+    int max_name = (per_key & ~3) - (int)sizeof(int) - 1;
+    return max_name < MAX_NAME_LENGTH - 1 ? max_name : MAX_NAME_LENGTH - 1;
+}
+
+
+/**
+ * @brief Fait d'un répertoire un répertoire trié, indexé par un B-arbre.
+ *
+ * Les entrées déjà présentes (normalement "." et "..", à la création) sont
+ * insérées dans l'arbre. Un index haché existant est libéré.
+ *
+ * @param part Pointeur vers la partition.
+ * @param dir_inode Répertoire concerné.
+ * @return 0 en cas de succès, -1 en cas d'erreur (le répertoire reste non trié).
+ */
+int dir_btree_create(partition_t *part, int dir_inode) {
+    inode_t *dir = &part->inodes[dir_inode];
+    if (dir->flags & INODE_FL_DIR_BTREE) return 0;
+
+    int root = allocate_block(part);
+    if (root == -1) {
+        printf("Erreur: Plus de blocs disponibles\n");
+        return -1;
+    }
+    if (dir->dir_index_block != -1) {
+        dir_index_free(part, dir_inode);
+    }
+    node_init(part, btree_node(part, root), 1);
+    dir->dir_index_block = root;
+    dir->flags |= INODE_FL_DIR_BTREE;
+
+    int max_name = dir_btree_max_name(part);
+    block_map_cache_t cache = BLOCK_MAP_CACHE_INIT;
+    for (int b = 0; b < dir->dir_blocks; b++) {
+        int block_num = inode_bmap(part, dir_inode, b, 0, &cache);
+        if (block_num == -1) continue;
+        char *block = block_ptr(part, block_num);
+        for (int off = 0; off < part->block_size; off += dir_rec_len((dir_entry_t *)(block + off))) {
+            dir_entry_t *entry = (dir_entry_t *)(block + off);
+            if (entry->inode_num == 0) continue;
+            if (entry->name_len > max_name ||
+                dir_btree_insert(part, dir_inode, entry->name, b * part->block_size + off) != 0) {
+                printf("Erreur: Impossible de trier le repertoire\n");
+                dir_btree_free(part, dir_inode);
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+
+/**
+ * @brief Libère le B-arbre d'un répertoire trié, qui redevient non trié.
+ *
+ * @param part Pointeur vers la partition.
+ * @param dir_inode Répertoire concerné.
+ */
+void dir_btree_free(partition_t *part, int dir_inode) {
+    inode_t *dir = &part->inodes[dir_inode];
+    if (dir->dir_index_block != -1) {
+        free_subtree(part, dir->dir_index_block);
+    }
+    dir->dir_index_block = -1;
+    dir->flags &= ~INODE_FL_DIR_BTREE;
+}
+
+
+/**
+ * @brief Recherche un nom dans le B-arbre d'un répertoire trié.
+ *
+ * @param part Pointeur vers la partition.
+ * @param dir_inode Répertoire trié.
+ * @param name Nom recherché.
+ * @param pos Si non NULL, reçoit la position de l'entrée trouvée.
+ * @return L'entrée portant ce nom, ou NULL si le nom est absent.
+ */
+dir_entry_t *dir_btree_lookup(partition_t *part, int dir_inode, const char *name, int *pos) {
+    int len = strlen(name);
+    if (len >= MAX_NAME_LENGTH) return NULL;
+
+    dir_btree_node_t *leaf = find_leaf(part, dir_inode, name, len);
+    int i = node_lower_bound(leaf, name, len);
+    if (i == leaf->count || key_cmp(node_key(leaf, i), name, len) != 0) return NULL;
+
+    int entry_pos = node_key(leaf, i)->value;
+    if (pos != NULL) *pos = entry_pos;
+    return dir_entry_at(part, dir_inode, entry_pos);
+}
+
+
+/**
+ * @brief Enregistre dans le B-arbre une entrée qui vient d'être écrite.
+ *
+ * Un nœud plein est coupé en deux; quand la racine est coupée, elle garde son
+ * bloc (dir_index_block ne change pas) et devient le parent des deux moitiés.
+ *
+ * @param part Pointeur vers la partition.
+ * @param dir_inode Répertoire trié.
+ * @param name Nom de l'entrée (au plus dir_btree_max_name octets).
+ * @param pos Position de l'entrée dans le répertoire.
+ * @return 0 en cas de succès, -1 si les blocs manquent (l'arbre ne contient
+ *         alors plus tous les noms et doit être libéré).
+ */
+int dir_btree_insert(partition_t *part, int dir_inode, const char *name, int pos) {
+    int root = part->inodes[dir_inode].dir_index_block;
+    char sep[MAX_NAME_LENGTH];
+    int sep_len, right;
+
+    int result = insert_rec(part, root, name, strlen(name), pos, sep, &sep_len, &right);
+    if (result != 1) return result;
+
+    // Racine coupée: déplacer sa moitié basse dans un nouveau bloc
+    int left = allocate_block(part);
+    if (left == -1) {
+        free_subtree(part, right);
+        return -1;
+    }
+    dir_btree_node_t *root_node = btree_node(part, root);
+    memcpy(btree_node(part, left), root_node, part->block_size);
+    node_init(part, root_node, 0);
+    root_node->child0 = left;
+    node_append(root_node, sep, sep_len, right);
+    return 0;
+}
+
+
+/**
+ * @brief Retire du B-arbre une entrée du répertoire.
+ *
+ * @param part Pointeur vers la partition.
+ * @param dir_inode Répertoire trié.
+ * @param name Nom de l'entrée.
+ * @param pos Position de l'entrée dans le répertoire.
+ */
+void dir_btree_remove(partition_t *part, int dir_inode, const char *name, int pos) {
+    int len = strlen(name);
+    dir_btree_node_t *leaf = find_leaf(part, dir_inode, name, len);
+    int i = node_lower_bound(leaf, name, len);
+    if (i == leaf->count || key_cmp(node_key(leaf, i), name, len) != 0 || node_key(leaf, i)->value != pos) return;
+
+    // La place de la clé sera reprise quand le nœud sera tassé
+    memmove(&leaf->slots[i], &leaf->slots[i + 1], (leaf->count - i - 1) * sizeof(uint16_t));
+    leaf->count--;
+}
+
+
+/**
+ * @brief Lit dans l'ordre des noms les entrées suivantes d'un répertoire trié.
+ *
+ * Pour parcourir un grand répertoire page par page, l'appelant repasse le
+ * dernier nom reçu dans @p after: le parcours reprend juste après lui, même si
+ * le répertoire a été modifié entre-temps.
+ *
+ * @param part Pointeur vers la partition.
+ * @param dir_inode Répertoire trié.
+ * @param after NULL pour partir du début, sinon seuls les noms qui suivent celui-ci sont renvoyés.
+ * @param prefix NULL, ou seuls les noms commençant par ce préfixe sont renvoyés.
+ * @param records Tableau de l'appelant, rempli à partir de l'indice 0.
+ * @param max_records Taille du tableau.
+ * @return Le nombre d'entrées écrites (0 à la fin), -1 si le répertoire n'est pas trié.
+ */
+int dir_btree_scan(partition_t *part, int dir_inode, const char *after, const char *prefix,
+                   dir_record_t *records, int max_records) {
+    if (!(part->inodes[dir_inode].flags & INODE_FL_DIR_BTREE)) return -1;
+
+    int prefix_len = prefix != NULL ? strlen(prefix) : 0;
+    if (after != NULL && prefix != NULL && strcmp(after, prefix) < 0) after = NULL;
+
+    // Descendre jusqu'à la feuille où commence le parcours
+    dir_btree_node_t *leaf;
+    int i;
+    if (after != NULL) {
+        int len = strlen(after);
+        leaf = find_leaf(part, dir_inode, after, len);
+        i = node_upper_bound(leaf, after, len);
+    } else {
+        leaf = find_leaf(part, dir_inode, prefix != NULL ? prefix : "", prefix_len);
+        i = node_lower_bound(leaf, prefix != NULL ? prefix : "", prefix_len);
+    }
+
+    int count = 0;
+    while (count < max_records) {
+        if (i == leaf->count) {
+            if (leaf->next == -1) break;
+            leaf = btree_node(part, leaf->next);
+            i = 0;
+            continue;
+        }
+        dir_btree_key_t *key = node_key(leaf, i++);
+        if (prefix != NULL && (key->len < prefix_len || memcmp(key->name, prefix, prefix_len) != 0)) break;
+
+        dir_entry_t *entry = dir_entry_at(part, dir_inode, key->value);
+        if (entry == NULL || entry->inode_num == 0) continue;
+        memcpy(records[count].name, key->name, key->len);
+        records[count].name[key->len] = '\0';
+        records[count].inode_num = entry->inode_num;
+        records[count].file_type = dir_entry_type(part, entry);
+        count++;
+    }
+    return count;
+}
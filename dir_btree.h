@@ -0,0 +1,20 @@
+#ifndef DIR_BTREE_H
+#define DIR_BTREE_H
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "structure.h"
+#include "block.h"
+#include "inode.h"
+#include "dir_entry.h"
+int dir_btree_max_name(partition_t *part);
+int dir_btree_create(partition_t *part, int dir_inode);
+void dir_btree_free(partition_t *part, int dir_inode);
+dir_entry_t *dir_btree_lookup(partition_t *part, int dir_inode, const char *name, int *pos);
+int dir_btree_insert(partition_t *part, int dir_inode, const char *name, int pos);
+void dir_btree_remove(partition_t *part, int dir_inode, const char *name, int pos);
+int dir_btree_scan(partition_t *part, int dir_inode, const char *after, const char *prefix,
+                   dir_record_t *records, int max_records);
+
+#endif // DIR_BTREE_H
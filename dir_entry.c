@@ -0,0 +1,234 @@
+/**
+ * @file dir_entry.c
+ * @brief Entrées de répertoire de longueur variable.
+ *
+ * Chaque bloc d'un répertoire est couvert par une suite d'entrées (voir
+ * dir_entry_t): un nom court n'occupe que quelques octets, et les noms peuvent
+ * faire jusqu'à MAX_NAME_LENGTH - 1 octets. Ce module place et retire les
+ * entrées dans un bloc, et convertit au chargement les répertoires de l'ancien
+ * format à entrées fixes de 36 octets.
+ */
+
+#include "dir_entry.h"
+#include "dir_index.h"
+
+
+/**
+ * @brief Type de fichier à stocker dans une entrée, d'après le mode de l'inode.
+ *
+ * @param mode Mode de l'inode (type et permissions).
+ * @return Le type DIR_FT_* correspondant.
+ */
+uint8_t dir_file_type(int mode) {
+    switch (mode & 0170000) {
+        case 040000: return DIR_FT_DIR;
+        case 0120000: return DIR_FT_SYMLINK;
+        case 0100000: return DIR_FT_REG;
+        default: return DIR_FT_UNKNOWN;
+    }
+}
+
+
+/**
+ * @brief Type de fichier d'une entrée, sans lire l'inode quand l'entrée le connaît.
+ *
+ * @param part Pointeur vers la partition.
+ * @param entry Entrée occupée.
+ * @return Le type DIR_FT_* de l'entrée.
+ */
+int dir_entry_type(partition_t *part, const dir_entry_t *entry) {
+    if (entry->file_type != DIR_FT_UNKNOWN) return entry->file_type;
+    return dir_file_type(part->inodes[entry->inode_num].mode);
+}
+
+
+/**
+ * @brief Initialise un bloc de répertoire vide: une seule entrée libre qui le couvre.
+ *
+ * @param part Pointeur vers la partition.
+ * @param block Contenu du bloc.
+ */
+void dir_block_init(partition_t *part, char *block) {
+    memset(block, 0, part->block_size);
+    dir_set_rec_len((dir_entry_t *)block, part->block_size);
+}
+
+
+/**
+ * @brief Place une entrée dans un bloc de répertoire, s'il y a la place.
+ *
+ * La place est prise dans une entrée libre, ou après le nom d'une entrée
+ * occupée dont rec_len dépasse ce que son nom demande (l'entrée est alors
+ * coupée en deux). Le nom doit faire au plus MAX_NAME_LENGTH - 1 octets.
+ *
+ * @param part Pointeur vers la partition.
+ * @param block Contenu du bloc.
+ * @param name Nom de l'entrée.
+ * @param inode_num Inode de l'entrée.
+ * @param offset Reçoit le décalage de l'entrée dans le bloc.
+ * @return L'entrée écrite, ou NULL si le bloc n'a pas assez de place.
+ */
+dir_entry_t *dir_block_insert(partition_t *part, char *block, const char *name, int inode_num, int *offset) {
+    int name_len = strlen(name);
+    int needed = DIR_REC_LEN(name_len);
+
+    for (int off = 0; off < part->block_size; ) {
+        dir_entry_t *entry = (dir_entry_t *)(block + off);
+        int rec_len = dir_rec_len(entry);
+        int used = entry->inode_num != 0 ? DIR_REC_LEN(entry->name_len) : 0;
+
+        if (rec_len - used >= needed) {
+            if (used != 0) {
+                // Couper l'entrée: la nouvelle prend la place libre qui suit le nom
+                dir_set_rec_len(entry, used);
+                entry = (dir_entry_t *)(block + off + used);
+                dir_set_rec_len(entry, rec_len - used);
+                off += used;
+            }
+            entry->inode_num = inode_num;
+            entry->name_len = name_len;
+            entry->file_type = dir_file_type(part->inodes[inode_num].mode);
+            memcpy(entry->name, name, name_len + 1);
+            *offset = off;
+            return entry;
+        }
+        off += rec_len;
+    }
+    return NULL;
+}
+
+
+/**
+ * @brief Retire l'entrée au décalage offset d'un bloc de répertoire.
+ *
+ * L'entrée est fusionnée avec la précédente du bloc; la première entrée d'un
+ * bloc reste en place et devient libre.
+ *
+ * @param block Contenu du bloc.
+ * @param offset Décalage de l'entrée dans le bloc.
+ */
+void dir_block_remove(char *block, int offset) {
+    dir_entry_t *entry = (dir_entry_t *)(block + offset);
+    if (offset == 0) {
+        entry->inode_num = 0;
+        return;
+    }
+
+    // Chercher l'entrée précédente
+    int prev = 0;
+    while (prev + dir_rec_len((dir_entry_t *)(block + prev)) < offset) {
+        prev += dir_rec_len((dir_entry_t *)(block + prev));
+    }
+    dir_entry_t *prev_entry = (dir_entry_t *)(block + prev);
+    dir_set_rec_len(prev_entry, dir_rec_len(prev_entry) + dir_rec_len(entry));
+    entry->inode_num = 0;
+}
+
+
+/**
+ * @brief Adresse de l'entrée à la position pos d'un répertoire.
+ *
+ * @param part Pointeur vers la partition.
+ * @param dir_inode Répertoire.
+ * @param pos Position (bloc de fichier * taille de bloc + décalage dans le bloc).
+ * @return L'entrée, ou NULL si son bloc n'existe pas.
+ */
+dir_entry_t *dir_entry_at(partition_t *part, int dir_inode, int pos) {
+    int block_num = inode_bmap(part, dir_inode, pos / part->block_size, 0, NULL);
+    if (block_num == -1) return NULL;
+    return (dir_entry_t *)(block_ptr(part, block_num) + pos % part->block_size);
+}
+
+
+/**
+ * @brief Réécrit un répertoire de l'ancien format (dir_entry_fixed_t) en entrées de longueur variable.
+ *
+ * Les entrées sont recopiées à la suite dans les blocs du répertoire (un bloc
+ * est ajouté si des noms longs ne tiennent plus, ou si le répertoire n'en a
+ * aucun), les blocs restants sont vidés et l'index haché est reconstruit puisque les positions changent.
+ *
+ * @param part Pointeur vers la partition.
+ * @param dir_inode Répertoire à convertir.
+ * @return 0 en cas de succès, -1 si la mémoire ou les blocs manquent.
+ */
+int dir_convert_fixed(partition_t *part, int dir_inode) {
+    inode_t *dir = &part->inodes[dir_inode];
+    int per_block = part->block_size / sizeof(dir_entry_fixed_t);
+    block_map_cache_t cache = BLOCK_MAP_CACHE_INIT;
+
+    // Un répertoire qui a perdu son seul bloc repart d'un bloc vide
+    if (dir->dir_blocks == 0) {
+        if (inode_bmap(part, dir_inode, 0, 1, NULL) == -1) return -1;
+        dir->dir_blocks = 1;
+    }
+
+    // Copier les anciennes entrées: la réécriture se fait dans les mêmes blocs
+    dir_entry_fixed_t *old = (dir_entry_fixed_t *)malloc((size_t)dir->dir_blocks * per_block * sizeof(dir_entry_fixed_t));
+    if (old == NULL) return -1;
+    int count = 0, dots = 0;
+    for (int b = 0; b < dir->dir_blocks; b++) {
+        int block_num = inode_bmap(part, dir_inode, b, 0, &cache);
+        if (block_num == -1) continue;
+        dir_entry_fixed_t *entries = (dir_entry_fixed_t *)block_ptr(part, block_num);
+        for (int j = 0; j < per_block; j++) {
+            // Une entrée qui ne désigne pas un inode utilisé est abandonnée
+            int ino = entries[j].inode_num;
+            if (ino <= 0 || ino >= part->num_inodes || part->inodes[ino].mode == 0) continue;
+            old[count] = entries[j];
+            old[count].name[DIR_FIXED_NAME_LENGTH - 1] = '\0';
+            if (strcmp(old[count].name, ".") == 0 || strcmp(old[count].name, "..") == 0) dots++;
+            count++;
+        }
+    }
+    dir_index_free(part, dir_inode);
+
+    // Réécrire les entrées à la suite
+    int b = 0, off = 0, last_off = -1, size = 0;
+    char *block = block_ptr(part, inode_bmap(part, dir_inode, 0, 0, &cache));
+    for (int i = 0; i < count; i++) {
+        int name_len = strlen(old[i].name);
+        int needed = DIR_REC_LEN(name_len);
+        if (off + needed > part->block_size) {
+            // Bloc plein: la dernière entrée s'étend jusqu'à la fin du bloc
+            dir_set_rec_len((dir_entry_t *)(block + last_off), part->block_size - last_off);
+            b++;
+            off = 0;
+            if (b >= dir->dir_blocks) {
+                if (inode_bmap(part, dir_inode, b, 1, NULL) == -1) {
+                    free(old);
+                    return -1;
+                }
+                dir->dir_blocks++;
+            }
+            block = block_ptr(part, inode_bmap(part, dir_inode, b, 0, &cache));
+        }
+        dir_entry_t *entry = (dir_entry_t *)(block + off);
+        entry->inode_num = old[i].inode_num;
+        dir_set_rec_len(entry, needed);
+        entry->name_len = name_len;
+        entry->file_type = dir_file_type(part->inodes[old[i].inode_num].mode);
+        memcpy(entry->name, old[i].name, name_len + 1);
+        last_off = off;
+        off += needed;
+        size += needed;
+    }
+    if (last_off == -1) {
+        dir_block_init(part, block);
+    } else {
+        dir_set_rec_len((dir_entry_t *)(block + last_off), part->block_size - last_off);
+    }
+    for (int rest = b + 1; rest < dir->dir_blocks; rest++) {
+        dir_block_init(part, block_ptr(part, inode_bmap(part, dir_inode, rest, 0, &cache)));
+    }
+    free(old);
+
+    // "." et ".." restent comptés même quand ils désignent l'inode 0 (racines),
+    // comme à la création du répertoire
+    dir->dir_count = count + 2 - dots;
+    dir->size = size;
+    dir->dir_free_hint = 0;
+    if (dir->dir_blocks > 1) {
+        dir_index_build(part, dir_inode, 0);
+    }
+    return 0;
+}
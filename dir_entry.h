@@ -0,0 +1,33 @@
+#ifndef DIR_ENTRY_H
+#define DIR_ENTRY_H
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "structure.h"
+#include "block.h"
+#include "inode.h"
+
+/**
+ * @brief Taille d'une entrée jusqu'à la suivante (rec_len vaut 0 pour 65536).
+ */
+static inline int dir_rec_len(const dir_entry_t *entry) {
+    return entry->rec_len != 0 ? entry->rec_len : 65536;
+}
+
+/**
+ * @brief Positionne la taille d'une entrée (65536 est stocké comme 0).
+ */
+static inline void dir_set_rec_len(dir_entry_t *entry, int len) {
+    entry->rec_len = (uint16_t)len;
+}
+
+uint8_t dir_file_type(int mode);
+int dir_entry_type(partition_t *part, const dir_entry_t *entry);
+void dir_block_init(partition_t *part, char *block);
+dir_entry_t *dir_block_insert(partition_t *part, char *block, const char *name, int inode_num, int *offset);
+void dir_block_remove(char *block, int offset);
+dir_entry_t *dir_entry_at(partition_t *part, int dir_inode, int pos);
+int dir_convert_fixed(partition_t *part, int dir_inode);
+
+#endif // DIR_ENTRY_H
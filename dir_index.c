@@ -0,0 +1,297 @@
+/**
+ * @file dir_index.c
+ * @brief Index haché des répertoires.
+ *
+ * Un répertoire de plus d'un bloc reçoit un index stocké sur la partition:
+ * une table à adressage ouvert (sondage linéaire) dont les cases associent le
+ * hash d'un nom à la position de son entrée. find_file_in_dir n'a alors plus
+ * à comparer tous les noms du répertoire. L'index est tenu à jour par
+ * add_dir_entry et remove_dir_entry, et reconstruit quand il devient trop plein.
+ *
+ * Les répertoires triés (INODE_FL_DIR_BTREE) ont à la place un B-arbre: les
+ * fonctions dir_index_* publiques leur passent la main (voir dir_btree.c).
+ */
+
+#include "dir_index.h"
+#include "dir_btree.h"
+
+
+/**
+ * @brief Calcule le hash d'un nom d'entrée (FNV-1a 32 bits).
+ *
+ * @param name Nom terminé par '\0'.
+ * @return Le hash du nom.
+ */
+uint32_t dir_hash(const char *name) {
+    uint32_t hash = 2166136261u;
+    for (const unsigned char *p = (const unsigned char *)name; *p; p++) {
+        hash ^= *p;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+
+/**
+ * @brief Adresse de la case i de l'index (racine -> table de pages -> page).
+ */
+static dir_index_slot_t *index_slot(partition_t *part, dir_index_root_t *root, int i) {
+    int per_page = part->block_size / sizeof(dir_index_slot_t);
+    int per_table = part->block_size / sizeof(int);
+    int page_idx = i / per_page;
+    int *table = (int *)block_ptr(part, root->tables[page_idx / per_table]);
+    dir_index_slot_t *page = (dir_index_slot_t *)block_ptr(part, table[page_idx % per_table]);
+    return &page[i % per_page];
+}
+
+
+/**
+ * @brief Libère les pages, les tables de pages et la racine d'un index.
+ */
+static void release_index(partition_t *part, int root_block) {
+    dir_index_root_t *root = (dir_index_root_t *)block_ptr(part, root_block);
+    int per_table = part->block_size / sizeof(int);
+    for (int p = 0; p < root->num_pages; p++) {
+        int *table = (int *)block_ptr(part, root->tables[p / per_table]);
+        free_block(part, table[p % per_table]);
+    }
+    for (int t = 0; t < root->num_tables; t++) {
+        free_block(part, root->tables[t]);
+    }
+    free_block(part, root_block);
+}
+
+
+/**
+ * @brief Place une entrée dans la première case vide ou supprimée de sa chaîne de sondage.
+ *
+ * L'appelant garantit qu'il reste au moins une case libre.
+ */
+static void slot_insert(partition_t *part, dir_index_root_t *root, uint32_t hash, int pos) {
+    int mask = root->num_slots - 1;
+    int i = hash & mask;
+    dir_index_slot_t *slot = index_slot(part, root, i);
+    while (slot->pos > 0) {
+        i = (i + 1) & mask;
+        slot = index_slot(part, root, i);
+    }
+    if (slot->pos == DIR_INDEX_DELETED) root->deleted--;
+    slot->hash = hash;
+    slot->pos = pos + 1;
+    root->used++;
+}
+
+
+/**
+ * @brief Construit l'index d'un répertoire à partir de ses entrées.
+ *
+ * La table a au moins deux fois plus de cases que d'entrées (et au moins
+ * min_slots), arrondi à une puissance de 2. En cas d'échec (plus de blocs, ou
+ * table trop grande pour les tables de pages que peut lister la racine) le
+ * répertoire reste sans index et les recherches se font par parcours des entrées.
+ *
+ * @param part Pointeur vers la partition.
+ * @param dir_inode Répertoire à indexer (sans index existant).
+ * @param min_slots Nombre minimal de cases souhaité.
+ * @return 0 en cas de succès, -1 sinon.
+ */
+int dir_index_build(partition_t *part, int dir_inode, int min_slots) {
+    int per_page = part->block_size / sizeof(dir_index_slot_t);
+    int per_table = part->block_size / sizeof(int);
+    int max_tables = (part->block_size - sizeof(dir_index_root_t)) / sizeof(int);
+    int dir_blocks = part->inodes[dir_inode].dir_blocks;
+    int count = part->inodes[dir_inode].dir_count;
+    block_map_cache_t cache = BLOCK_MAP_CACHE_INIT;
+
+    long long num_slots = per_page;
+    while (num_slots < 2LL * count || num_slots < min_slots) num_slots *= 2;
+    long long num_pages = num_slots / per_page;
+    int num_tables = (num_pages + per_table - 1) / per_table;
+    if (num_slots > INT_MAX || num_tables > max_tables) return -1;
+
+    // Allouer la racine, les tables de pages et les pages
+    int root_block = allocate_block(part);
+    if (root_block == -1) return -1;
+    dir_index_root_t *root = (dir_index_root_t *)block_ptr(part, root_block);
+    memset(root, 0, part->block_size);
+    for (int t = 0; t < num_tables; t++) {
+        int table = allocate_block(part);
+        if (table == -1) {
+            release_index(part, root_block);
+            return -1;
+        }
+        root->tables[t] = table;
+        root->num_tables++;
+    }
+    for (int p = 0; p < num_pages; p++) {
+        int page = allocate_block(part);
+        if (page == -1) {
+            release_index(part, root_block);
+            return -1;
+        }
+        memset(block_ptr(part, page), 0, part->block_size);
+        ((int *)block_ptr(part, root->tables[p / per_table]))[p % per_table] = page;
+        root->num_pages++;
+    }
+    root->num_slots = num_slots;
+
+    // Insérer toutes les entrées
+    for (int b = 0; b < dir_blocks; b++) {
+        int block_num = inode_bmap(part, dir_inode, b, 0, &cache);
+        if (block_num == -1) continue;
+        char *block = block_ptr(part, block_num);
+        for (int off = 0; off < part->block_size; off += dir_rec_len((dir_entry_t *)(block + off))) {
+            dir_entry_t *entry = (dir_entry_t *)(block + off);
+            if (entry->inode_num != 0) {
+                slot_insert(part, root, dir_hash(entry->name), b * part->block_size + off);
+            }
+        }
+    }
+
+    part->inodes[dir_inode].dir_index_block = root_block;
+    return 0;
+}
+
+
+/**
+ * @brief Construit l'index d'un répertoire, ou note quand réessayer si c'est impossible.
+ */
+static void index_rebuild(partition_t *part, int dir_inode, int min_slots) {
+    if (dir_index_build(part, dir_inode, min_slots) == 0) {
+        part->dir_index_retry[dir_inode] = 0;
+    } else {
+        part->dir_index_retry[dir_inode] = 2 * part->inodes[dir_inode].dir_count;
+    }
+}
+
+
+/**
+ * @brief Libère l'index d'un répertoire (s'il en a un).
+ *
+ * @param part Pointeur vers la partition.
+ * @param dir_inode Répertoire concerné.
+ */
+void dir_index_free(partition_t *part, int dir_inode) {
+    if (part->inodes[dir_inode].flags & INODE_FL_DIR_BTREE) {
+        dir_btree_free(part, dir_inode);
+        return;
+    }
+    int root_block = part->inodes[dir_inode].dir_index_block;
+    if (root_block == -1) return;
+
+    release_index(part, root_block);
+    part->inodes[dir_inode].dir_index_block = -1;
+}
+
+
+/**
+ * @brief Recherche un nom dans l'index d'un répertoire.
+ *
+ * @param part Pointeur vers la partition.
+ * @param dir_inode Répertoire indexé.
+ * @param name Nom recherché.
+ * @param pos Si non NULL, reçoit la position de l'entrée trouvée.
+ * @return L'entrée portant ce nom, ou NULL si le nom est absent.
+ */
+dir_entry_t *dir_index_lookup(partition_t *part, int dir_inode, const char *name, int *pos) {
+    if (part->inodes[dir_inode].flags & INODE_FL_DIR_BTREE) {
+        return dir_btree_lookup(part, dir_inode, name, pos);
+    }
+    dir_index_root_t *root = (dir_index_root_t *)block_ptr(part, part->inodes[dir_inode].dir_index_block);
+    uint32_t hash = dir_hash(name);
+    int mask = root->num_slots - 1;
+    int i = hash & mask;
+
+    for (int n = 0; n < root->num_slots; n++) {
+        dir_index_slot_t *slot = index_slot(part, root, i);
+        if (slot->pos == DIR_INDEX_EMPTY) return NULL;
+        if (slot->pos > 0 && slot->hash == hash) {
+            dir_entry_t *entry = dir_entry_at(part, dir_inode, slot->pos - 1);
+            if (entry != NULL && entry->inode_num != 0 && strcmp(entry->name, name) == 0) {
+                if (pos != NULL) *pos = slot->pos - 1;
+                return entry;
+            }
+        }
+        i = (i + 1) & mask;
+    }
+    return NULL;
+}
+
+
+/**
+ * @brief Enregistre dans l'index une entrée qui vient d'être écrite.
+ *
+ * Un répertoire sans index en reçoit un dès qu'une entrée est placée hors de
+ * son premier bloc. Un répertoire trié qui n'a plus de blocs pour son B-arbre
+ * redevient non trié. Si la table dépasse 3/4 de remplissage (cases supprimées
+ * comprises), elle est reconstruite, agrandie si nécessaire.
+ *
+ * Quand la construction échoue, le répertoire reste sans index jusqu'à ce que
+ * son nombre d'entrées ait doublé: chaque insertion ne relance pas un parcours
+ * complet du répertoire.
+ *
+ * @param part Pointeur vers la partition.
+ * @param dir_inode Répertoire contenant l'entrée.
+ * @param name Nom tel qu'il est stocké dans l'entrée.
+ * @param pos Position de l'entrée dans le répertoire.
+ */
+void dir_index_insert(partition_t *part, int dir_inode, const char *name, int pos) {
+    if (part->inodes[dir_inode].flags & INODE_FL_DIR_BTREE) {
+        if (dir_btree_insert(part, dir_inode, name, pos) == 0) return;
+        // Plus de blocs pour l'arbre: le répertoire n'est plus trié et
+        // repasse à l'index haché, construit à partir de ses entrées
+        dir_btree_free(part, dir_inode);
+    }
+    if (part->inodes[dir_inode].dir_index_block == -1) {
+        if (pos >= part->block_size && part->inodes[dir_inode].dir_count >= part->dir_index_retry[dir_inode]) {
+            index_rebuild(part, dir_inode, 0);
+        }
+        return;
+    }
+
+    dir_index_root_t *root = (dir_index_root_t *)block_ptr(part, part->inodes[dir_inode].dir_index_block);
+    if ((root->used + root->deleted + 1) * 4 > root->num_slots * 3) {
+        // L'entrée est déjà dans le répertoire: la reconstruction la prend en compte
+        int min_slots = (root->used + 1) * 2 > root->num_slots ? root->num_slots * 2 : root->num_slots;
+        dir_index_free(part, dir_inode);
+        index_rebuild(part, dir_inode, min_slots);
+        return;
+    }
+    slot_insert(part, root, dir_hash(name), pos);
+}
+
+
+/**
+ * @brief Retire de l'index une entrée du répertoire.
+ *
+ * La case devient DIR_INDEX_DELETED pour ne pas couper les chaînes de sondage.
+ *
+ * @param part Pointeur vers la partition.
+ * @param dir_inode Répertoire contenant l'entrée.
+ * @param name Nom de l'entrée.
+ * @param pos Position de l'entrée dans le répertoire.
+ */
+void dir_index_remove(partition_t *part, int dir_inode, const char *name, int pos) {
+    if (part->inodes[dir_inode].flags & INODE_FL_DIR_BTREE) {
+        dir_btree_remove(part, dir_inode, name, pos);
+        return;
+    }
+    if (part->inodes[dir_inode].dir_index_block == -1) return;
+
+    dir_index_root_t *root = (dir_index_root_t *)block_ptr(part, part->inodes[dir_inode].dir_index_block);
+    uint32_t hash = dir_hash(name);
+    int mask = root->num_slots - 1;
+    int i = hash & mask;
+
+    for (int n = 0; n < root->num_slots; n++) {
+        dir_index_slot_t *slot = index_slot(part, root, i);
+        if (slot->pos == DIR_INDEX_EMPTY) return;
+        if (slot->pos == pos + 1) {
+            slot->pos = DIR_INDEX_DELETED;
+            root->used--;
+            root->deleted++;
+            return;
+        }
+        i = (i + 1) & mask;
+    }
+}
@@ -0,0 +1,18 @@
+#ifndef DIR_INDEX_H
+#define DIR_INDEX_H
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "structure.h"
+#include "block.h"
+#include "inode.h"
+#include "dir_entry.h"
+uint32_t dir_hash(const char *name);
+int dir_index_build(partition_t *part, int dir_inode, int min_slots);
+void dir_index_free(partition_t *part, int dir_inode);
+dir_entry_t *dir_index_lookup(partition_t *part, int dir_inode, const char *name, int *pos);
+void dir_index_insert(partition_t *part, int dir_inode, const char *name, int pos);
+void dir_index_remove(partition_t *part, int dir_inode, const char *name, int pos);
+
+#endif // DIR_INDEX_H
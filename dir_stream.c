@@ -0,0 +1,157 @@
+/**
+ * @file dir_stream.c
+ * @brief Parcours d'un répertoire par lots, pour les programmes qui embarquent le système de fichiers.
+ *
+ * open_directory ouvre un répertoire, read_directory_batch remplit un tableau
+ * fourni par l'appelant avec les entrées suivantes (nom, inode, type) et
+ * close_directory libère le curseur. Chaque lot reprend là où le précédent
+ * s'est arrêté, sans reparcourir le début du répertoire; tous les blocs du
+ * répertoire sont couverts, quel que soit leur niveau d'indirection.
+ *
+ * Comme les descripteurs de file_table.c, un curseur oublie sa traduction de
+ * blocs quand part->map_generation change, et il est détaché du répertoire
+ * quand celui-ci est supprimé (voir free_inode): son numéro d'inode peut
+ * resservir à un autre répertoire.
+ */
+
+#include "dir_stream.h"
+
+
+/**
+ * @brief Ouvre un répertoire pour le parcourir par lots.
+ *
+ * @param part Pointeur vers la partition.
+ * @param path Chemin du répertoire (absolu ou relatif), NULL pour le répertoire courant.
+ * @return Le curseur, à libérer avec close_directory, ou NULL en cas d'erreur
+ *         (chemin introuvable, pas un répertoire, lecture interdite, mémoire).
+ */
+dir_stream_t *open_directory(partition_t *part, const char *path) {
+    int dir_inode = part->current_dir_inode;
+    if (path != NULL) {
+        nameidata_t nd;
+        int error = namei(part, path, NAMEI_FOLLOW, &nd);
+        if (error != 0) {
+            namei_perror(error, path);
+            return NULL;
+        }
+        dir_inode = nd.inode;
+    }
+    if ((part->inodes[dir_inode].mode & 0170000) != 040000) {
+        printf("Erreur: '%s' n'est pas un repertoire\n", path != NULL ? path : ".");
+        return NULL;
+    }
+    return open_directory_inode(part, dir_inode);
+}
+
+
+/**
+ * @brief Ouvre par son inode un répertoire déjà trouvé (par exemple pendant un parcours).
+ *
+ * @param part Pointeur vers la partition.
+ * @param dir_inode Inode du répertoire.
+ * @return Le curseur, à libérer avec close_directory, ou NULL en cas d'erreur
+ *         (pas un répertoire, lecture interdite, mémoire).
+ */
+dir_stream_t *open_directory_inode(partition_t *part, int dir_inode) {
+    if ((part->inodes[dir_inode].mode & 0170000) != 040000) {
+        printf("Erreur: L'inode %d n'est pas un repertoire\n", dir_inode);
+        return NULL;
+    }
+    if (!check_permission(part, dir_inode, 4)) {  // 4 = lecture
+        printf("Erreur: Permissions insuffisantes pour lire le contenu de ce repertoire\n");
+        return NULL;
+    }
+
+    dir_stream_t *stream = (dir_stream_t *)malloc(sizeof(dir_stream_t));
+    if (stream == NULL) {
+        printf("Erreur: Memoire insuffisante\n");
+        return NULL;
+    }
+    stream->part = part;
+    stream->dir_inode = dir_inode;
+    stream->block = 0;
+    stream->offset = 0;
+    stream->cache.inode_num = -1;
+    stream->map_generation = part->map_generation;
+    stream->next = part->dir_streams;
+    part->dir_streams = stream;
+    part->inodes[dir_inode].atime = time(NULL);
+    return stream;
+}
+
+
+/**
+ * @brief Lit le lot suivant d'entrées d'un répertoire.
+ *
+ * Les entrées libres sont sautées; "." et ".." sont renvoyés comme les autres.
+ * Le répertoire peut être modifié entre deux lots: les entrées ne bougent pas
+ * (voir dir_entry_t), et le curseur est recalé sur la première entrée qui
+ * commence à sa position ou après. Une entrée ajoutée derrière le curseur peut
+ * ne pas être vue, une entrée supprimée n'est plus renvoyée.
+ *
+ * @param stream Curseur ouvert par open_directory.
+ * @param records Tableau de l'appelant, rempli à partir de l'indice 0.
+ * @param max_records Taille du tableau.
+ * @return Le nombre d'entrées écrites (0 à la fin du répertoire), -1 si le
+ *         répertoire a été supprimé depuis l'ouverture.
+ */
+int read_directory_batch(dir_stream_t *stream, dir_record_t *records, int max_records) {
+    partition_t *part = stream->part;
+    if (stream->dir_inode == -1) return -1;
+    inode_t *dir = &part->inodes[stream->dir_inode];
+
+    // Blocs libérés ou réorganisés depuis le lot précédent: la traduction gardée est périmée
+    if (stream->map_generation != part->map_generation) {
+        stream->cache.inode_num = -1;
+        stream->map_generation = part->map_generation;
+    }
+
+    int count = 0;
+    while (count < max_records && stream->block < dir->dir_blocks) {
+        int block_num = inode_bmap(part, stream->dir_inode, stream->block, 0, &stream->cache);
+        if (block_num == -1) {
+            stream->block++;
+            stream->offset = 0;
+            continue;
+        }
+        char *block = block_ptr(part, block_num);
+
+        // Recaler le curseur sur une limite d'entrée
+        int off = 0;
+        while (off < stream->offset) {
+            off += dir_rec_len((dir_entry_t *)(block + off));
+        }
+
+        for (; off < part->block_size && count < max_records; off += dir_rec_len((dir_entry_t *)(block + off))) {
+            dir_entry_t *entry = (dir_entry_t *)(block + off);
+            if (entry->inode_num == 0) continue;
+
+            memcpy(records[count].name, entry->name, entry->name_len + 1);
+            records[count].inode_num = entry->inode_num;
+            records[count].file_type = dir_entry_type(part, entry);
+            count++;
+        }
+
+        if (off >= part->block_size) {
+            stream->block++;
+            stream->offset = 0;
+        } else {
+            stream->offset = off;
+        }
+    }
+    return count;
+}
+
+
+/**
+ * @brief Libère un curseur ouvert par open_directory.
+ *
+ * @param stream Curseur à libérer (NULL accepté).
+ */
+void close_directory(dir_stream_t *stream) {
+    if (stream == NULL) return;
+    dir_stream_t **link = &stream->part->dir_streams;
+    while (*link != stream) link = &(*link)->next;
+    *link = stream->next;
+    free(stream);
+}
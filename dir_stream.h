@@ -0,0 +1,17 @@
+#ifndef DIR_STREAM_H
+#define DIR_STREAM_H
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "structure.h"
+#include "block.h"
+#include "inode.h"
+#include "dir_entry.h"
+#include "permission.h"
+#include "folder_operation.h"
+dir_stream_t *open_directory(partition_t *part, const char *path);
+dir_stream_t *open_directory_inode(partition_t *part, int dir_inode);
+int read_directory_batch(dir_stream_t *stream, dir_record_t *records, int max_records);
+void close_directory(dir_stream_t *stream);
+
+#endif // DIR_STREAM_H
@@ -0,0 +1,254 @@
+/**
+ * @file file_io.c
+ * @brief Lecture et écriture positionnelles du contenu d'un fichier.
+ *
+ * inode_pread et inode_pwrite lisent ou écrivent len octets à partir d'un
+ * décalage, sans toucher au reste du fichier: seuls les blocs concernés sont
+ * copiés, et des blocs ne sont alloués que pour l'étendre. La taille et mtime
+ * sont mis à jour au fil de l'écriture.
+ *
+ * Les trois représentations de l'inode sont gérées. Un fichier inline qui ne
+ * tient plus dans l'inode passe aux extents; un fichier à extents grandit par
+ * de nouveaux extents, puis passe à la table de blocs quand ils sont tous
+ * utilisés. Avec la table de blocs, une écriture au-delà de la fin laisse des
+ * trous, qui se lisent comme des zéros. Les octets qui suivent la fin du
+ * fichier dans son dernier bloc sont toujours nuls (les blocs sont remis à
+ * zéro à l'allocation): étendre le fichier n'a donc pas à les effacer.
+ */
+
+#include "file_io.h"
+
+
+/**
+ * @brief Alloue les blocs d'un fichier à extents jusqu'au bloc de fichier num_blocks exclu.
+ *
+ * Quand les NUM_EXTENTS extents sont utilisés, le fichier passe à la table de
+ * blocs, où les blocs manquants sont alloués au fil de l'écriture. Si la
+ * partition se remplit, les blocs déjà obtenus sont gardés: l'écriture les
+ * remplit et s'arrête au premier bloc manquant.
+ */
+static void extents_reserve(partition_t *part, int inode_num, int num_blocks, block_map_cache_t *cache) {
+    inode_t *inode = &part->inodes[inode_num];
+    int have = 0;
+    for (int e = 0; e < inode->extent_count; e++) {
+        have += inode->extents[e].length;
+    }
+
+    while (have < num_blocks && inode->extent_count < NUM_EXTENTS) {
+        int length;
+        int start = allocate_extent(part, num_blocks - have, &length);
+        if (start < 0) return;  // Partition pleine
+
+        // Fusionner avec le dernier extent s'il est adjacent
+        extent_t *last = inode->extent_count > 0 ? &inode->extents[inode->extent_count - 1] : NULL;
+        if (last != NULL && last->start + last->length == start) {
+            last->length += length;
+        } else {
+            inode->extents[inode->extent_count].start = start;
+            inode->extents[inode->extent_count].length = length;
+            inode->extent_count++;
+        }
+        have += length;
+    }
+
+    if (have < num_blocks && inode_extents_to_map(part, inode_num) == 0) {
+        if (cache != NULL) cache->inode_num = -1;  // Le cache désignait un extent
+    }
+}
+
+
+/**
+ * @brief Rend les blocs d'un fichier à extents au-delà du bloc de fichier num_blocks.
+ *
+ * Après une écriture interrompue par une partition pleine, les blocs réservés
+ * qui n'ont rien reçu ne restent pas attachés au fichier.
+ */
+static void extents_trim(partition_t *part, int inode_num, int num_blocks, block_map_cache_t *cache) {
+    inode_t *inode = &part->inodes[inode_num];
+    int first = 0;
+    int kept = 0;
+    for (int e = 0; e < inode->extent_count; e++) {
+        extent_t *extent = &inode->extents[e];
+        int keep = num_blocks - first;
+        if (keep < 0) keep = 0;
+        first += extent->length;
+        if (keep >= extent->length) {
+            kept = e + 1;
+            continue;
+        }
+        for (int b = keep; b < extent->length; b++) {
+            free_block(part, extent->start + b);
+        }
+        extent->length = keep;
+        if (keep > 0) kept = e + 1;
+    }
+    if (kept == inode->extent_count) return;
+    inode->extent_count = kept;
+
+    // Les traductions gardées peuvent couvrir les blocs rendus
+    if (cache != NULL) cache->inode_num = -1;
+    part->map_generation++;
+}
+
+
+/**
+ * @brief Écrit dans les données inline ce qui tient dans l'inode.
+ *
+ * @return Le nombre d'octets écrits, ou -1 si offset est au-delà de INODE_INLINE_SIZE.
+ */
+static int inline_write(inode_t *inode, const char *data, int len, int offset) {
+    if (offset >= INODE_INLINE_SIZE) return -1;
+    if (len > INODE_INLINE_SIZE - offset) len = INODE_INLINE_SIZE - offset;
+
+    // Le reste de inline_data n'est pas forcément nul: effacer l'écart
+    if (offset > inode->size) {
+        memset(inode->inline_data + inode->size, 0, offset - inode->size);
+    }
+    memcpy(inode->inline_data + offset, data, len);
+    if (offset + len > inode->size) inode->size = offset + len;
+    inode->mtime = time(NULL);
+    return len;
+}
+
+
+/**
+ * @brief Copie data dans les blocs du fichier à partir de offset.
+ *
+ * @return Le nombre d'octets copiés (moins que len si la partition est pleine).
+ */
+static int copy_to_blocks(partition_t *part, int inode_num, const char *data, int len, int offset, block_map_cache_t *cache) {
+    int done = 0;
+    while (done < len) {
+        int pos = offset + done;
+        int in_block = pos % part->block_size;
+        int chunk = part->block_size - in_block;
+        if (chunk > len - done) chunk = len - done;
+
+        int block_num = inode_bmap(part, inode_num, pos / part->block_size, 1, cache);
+        if (block_num == -1) break;  // Plus d'espace disponible
+        memcpy(block_ptr(part, block_num) + in_block, data + done, chunk);
+        done += chunk;
+    }
+    return done;
+}
+
+
+/**
+ * @brief Lit jusqu'à len octets d'un fichier à partir de offset.
+ *
+ * Ne vérifie pas les permissions et ne met pas à jour atime.
+ *
+ * @param part Pointeur vers la partition contenant le fichier.
+ * @param inode_num Numéro de l'inode du fichier.
+ * @param buffer Tampon d'au moins len octets.
+ * @param len Nombre d'octets à lire.
+ * @param offset Position du premier octet à lire.
+ * @param cache Cache de traduction des blocs (inode_num à -1 pour un cache vide), ou NULL.
+ * @return Le nombre d'octets lus (0 à la fin du fichier), ou -1 si len ou offset est négatif.
+ */
+int inode_pread(partition_t *part, int inode_num, char *buffer, int len, int offset, block_map_cache_t *cache) {
+    inode_t *inode = &part->inodes[inode_num];
+    if (len < 0 || offset < 0) return -1;
+    if (offset >= inode->size) return 0;
+    if (len > inode->size - offset) len = inode->size - offset;
+
+    if (inode->flags & INODE_FL_INLINE) {
+        memcpy(buffer, inode->inline_data + offset, len);
+        return len;
+    }
+
+    int done = 0;
+    while (done < len) {
+        int pos = offset + done;
+        int in_block = pos % part->block_size;
+        int chunk = part->block_size - in_block;
+        if (chunk > len - done) chunk = len - done;
+
+        // Un trou se lit comme des zéros
+        int block_num = inode_bmap(part, inode_num, pos / part->block_size, 0, cache);
+        if (block_num == -1) {
+            memset(buffer + done, 0, chunk);
+        } else {
+            memcpy(buffer + done, block_ptr(part, block_num) + in_block, chunk);
+        }
+        done += chunk;
+    }
+    return len;
+}
+
+
+/**
+ * @brief Écrit len octets dans un fichier à partir de offset.
+ *
+ * Seuls les blocs couverts par [offset, offset + len) sont touchés; le fichier
+ * grandit si l'écriture dépasse sa fin. Ne vérifie pas les permissions.
+ *
+ * @param part Pointeur vers la partition contenant le fichier.
+ * @param inode_num Numéro de l'inode du fichier.
+ * @param data Données à écrire (quelconques, '\0' compris).
+ * @param len Nombre d'octets à écrire.
+ * @param offset Position du premier octet à écrire (peut dépasser la fin du fichier).
+ * @param cache Cache de traduction des blocs (inode_num à -1 pour un cache vide), ou NULL.
+ * @return Le nombre d'octets écrits (moins que len si la partition s'est
+ *         remplie en route), ou -1 en cas d'erreur (arguments invalides, taille
+ *         maximale dépassée ou partition pleine avant le premier octet).
+ */
+int inode_pwrite(partition_t *part, int inode_num, const char *data, int len, int offset, block_map_cache_t *cache) {
+    inode_t *inode = &part->inodes[inode_num];
+    if (len < 0 || offset < 0 || len > INT_MAX - offset) return -1;
+    if (len == 0) return 0;
+    int end = offset + len;
+    int num_blocks = (int)(((long long)end + part->block_size - 1) / part->block_size);
+
+    // Fichier vide sans bloc: inline s'il tient dans l'inode, extents sinon
+    if (inode->size == 0 && !(inode->flags & (INODE_FL_INLINE | INODE_FL_EXTENTS)) &&
+        inode->direct_blocks[0] == -1 && inode->indirect_block == -1 &&
+        inode->double_indirect_block == -1 && inode->triple_indirect_block == -1) {
+        if (end <= INODE_INLINE_SIZE) {
+            inode->flags |= INODE_FL_INLINE;
+        } else {
+            inode->flags |= INODE_FL_EXTENTS;
+            inode->extent_count = 0;
+        }
+    }
+
+    if (inode->flags & INODE_FL_INLINE) {
+        if (end <= INODE_INLINE_SIZE) {
+            return inline_write(inode, data, len, offset);
+        }
+
+        // Le fichier ne tient plus dans l'inode: passer aux extents
+        char old[INODE_INLINE_SIZE];
+        int old_size = inode->size;
+        memcpy(old, inode->inline_data, old_size);
+        clear_block_map(inode);
+        inode->flags |= INODE_FL_EXTENTS;
+        inode->extent_count = 0;
+        extents_reserve(part, inode_num, num_blocks, cache);
+        if (inode->extent_count == 0) {
+            // Aucun bloc libre: rester inline et y écrire ce qui tient
+            clear_block_map(inode);
+            inode->flags |= INODE_FL_INLINE;
+            memcpy(inode->inline_data, old, old_size);
+            return inline_write(inode, data, len, offset);
+        }
+        copy_to_blocks(part, inode_num, old, old_size, 0, cache);
+    } else if (inode->flags & INODE_FL_EXTENTS) {
+        extents_reserve(part, inode_num, num_blocks, cache);
+        if (inode->size == 0 && inode->extent_count == 0) {
+            // Fichier vide et aucun bloc libre: écrire ce qui tient dans l'inode
+            clear_block_map(inode);
+            inode->flags |= INODE_FL_INLINE;
+            return inline_write(inode, data, len, offset);
+        }
+    }
+
+    int written = copy_to_blocks(part, inode_num, data, len, offset, cache);
+    if (written > 0 && offset + written > inode->size) inode->size = offset + written;
+    if (written < len && (inode->flags & INODE_FL_EXTENTS)) {
+        extents_trim(part, inode_num, (inode->size + part->block_size - 1) / part->block_size, cache);
+    }
+    if (written == 0) return -1;
+    inode->mtime = time(NULL);
+    return written;
+}
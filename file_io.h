@@ -0,0 +1,14 @@
+#ifndef FILE_IO_H
+#define FILE_IO_H
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <time.h>
+#include "structure.h"
+#include "block.h"
+#include "inode.h"
+int inode_pread(partition_t *part, int inode_num, char *buffer, int len, int offset, block_map_cache_t *cache);
+int inode_pwrite(partition_t *part, int inode_num, const char *data, int len, int offset, block_map_cache_t *cache);
+
+#endif // FILE_IO_H
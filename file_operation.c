@@ -10,59 +10,67 @@
 
 #include "file_operation.h"
 
+/**
+ * @brief Cherche un nom dans les entrees d'un repertoire, sans passer par le cache.
+ * 
+ * @param part Pointeur vers la partition contenant le repertoire.
+ * @param dir_inode Numero d'inode du repertoire.
+ * @param name Nom du fichier à rechercher.
+ * @return int Le numero d'inode trouve, ou -1.
+ */
+static int scan_dir(partition_t *part, int dir_inode, const char *name) {
+    // Repertoire indexe: une recherche dans la table de hachage suffit
+    if (part->inodes[dir_inode].dir_index_block != -1) {
+        dir_entry_t *entry = dir_index_lookup(part, dir_inode, name, NULL);
+        return entry != NULL ? entry->inode_num : -1;
+    }
+    
+    // Parcourir tous les blocs du repertoire, quel que soit leur niveau d'indirection
+    int name_len = strlen(name);
+    block_map_cache_t cache = BLOCK_MAP_CACHE_INIT;
+    for (int i = 0; i < part->inodes[dir_inode].dir_blocks; i++) {
+        int block_num = inode_bmap(part, dir_inode, i, 0, &cache);
+        if (block_num == -1) continue;
+        
+        char *block = block_ptr(part, block_num);
+        for (int off = 0; off < part->block_size; off += dir_rec_len((dir_entry_t *)(block + off))) {
+            dir_entry_t *entry = (dir_entry_t *)(block + off);
+            // La longueur stockee evite de comparer les noms de taille differente
+            if (entry->inode_num != 0 && entry->name_len == name_len && memcmp(entry->name, name, name_len) == 0) {
+                return entry->inode_num;
+            }
+        }
+    }
+    
+    return -1;  // Fichier non trouve
+}
+
 /**
  * @brief Recherche un fichier dans un repertoire donne.
  * 
- * Cette fonction parcourt les entrees d'un repertoire pour trouver un fichier
- * portant le nom specifie. Si le fichier est trouve, elle retourne le numero
- * d'inode du fichier. Sinon, elle retourne -1.
+ * Cette fonction consulte d'abord le cache des noms (dcache), qui retient aussi
+ * les noms absents. Sinon elle parcourt les entrees du repertoire, ou interroge
+ * son index hache s'il en a un, puis met le resultat en cache. Si le fichier est
+ * trouve, elle retourne le numero d'inode du fichier. Sinon, elle retourne -1.
  * 
  * @param part Pointeur vers la partition contenant le repertoire.
  * @param dir_inode Numero d'inode du repertoire à rechercher.
  * @param name Nom du fichier à rechercher.
  * @return int Le numero d'inode du fichier trouve, ou -1 si le fichier n'est pas trouve.
  */
-
- int find_file_in_dir(partition_t *part, int dir_inode, const char *name) {
+int find_file_in_dir(partition_t *part, int dir_inode, const char *name) {
     if (!(part->inodes[dir_inode].mode & 040000)) {  // Verifier si c'est un repertoire
         return -1;
     }
     
-    // Parcourir tous les blocs du repertoire
-    for (int i = 0; i < NUM_DIRECT_BLOCKS; i++) {
-        int block_num = part->inodes[dir_inode].direct_blocks[i];
-        if (block_num == -1) continue;
-        
-
-        
-        dir_entry_t *dir_entries = (dir_entry_t *)(part->space->data + (block_num +USERSAPCE_OFSET) * BLOCK_SIZE);
-        int num_entries = BLOCK_SIZE / sizeof(dir_entry_t);
-        
-        for (int j = 0; j < num_entries; j++) {
-            if (dir_entries[j].inode_num != 0 && strcmp(dir_entries[j].name, name) == 0) {
-                return dir_entries[j].inode_num;
-            }
-        }
-    }
-    
-    // Verifier le bloc indirect
-    if (part->inodes[dir_inode].indirect_block != -1) {
-        int *indirect_table = (int *)(part->space->data + part->inodes[dir_inode].indirect_block * BLOCK_SIZE);
-        for (int i = 0; i < BLOCK_SIZE / sizeof(int); i++) {
-            if (indirect_table[i] != -1) {
-                dir_entry_t *dir_entries = (dir_entry_t *)(part->space->data + indirect_table[i] * BLOCK_SIZE);
-                int num_entries = BLOCK_SIZE / sizeof(dir_entry_t);
-                
-                for (int j = 0; j < num_entries; j++) {
-                    if (dir_entries[j].inode_num != 0 && strcmp(dir_entries[j].name, name) == 0) {
-                        return dir_entries[j].inode_num;
-                    }
-                }
-            }
-        }
+    int inode_num;
+    if (dcache_lookup(part, dir_inode, name, &inode_num)) {
+        return inode_num;
     }
     
-    return -1;  // Fichier non trouve
+    inode_num = scan_dir(part, dir_inode, name);
+    dcache_insert(part, dir_inode, name, inode_num);
+    return inode_num;
 }
 
 /**
@@ -79,18 +87,48 @@
  * @return int Le numero d'inode du fichier cree, ou -1 en cas d'erreur.
  */
 int create_file(partition_t *part, const char *name, int mode) {
-    // Verifier les permissions du repertoire courant pour l'ecriture (bit 2)
-    if (!check_permission(part, part->current_dir_inode, 2)) {
+    // Trouver le repertoire qui recevra le fichier et le nom à y creer
+    nameidata_t nd;
+    int error = namei(part, name, NAMEI_PARENT, &nd);
+    if (error != 0) {
+        namei_perror(error, name);
+        return -1;
+    }
+    int dir_inode = nd.parent;
+
+    // Verifier les permissions du repertoire parent pour l'ecriture (bit 2)
+    if (!check_permission(part, dir_inode, 2)) {
         printf("Erreur: Permissions insuffisantes pour creer dans ce repertoire\n");
         return -1;
     }
     
     // Verifier si le fichier existe dejà
-    if (find_file_in_dir(part, part->current_dir_inode, name) != -1) {
+    if (nd.inode != -1) {
         printf("Erreur: Un fichier avec ce nom existe deja\n");
         return -1;
     }
     
+    int inode_num = create_in_dir(part, dir_inode, nd.name, mode);
+    if (inode_num == -1) return -1;
+    
+    printf("%s '%s' cree avec succes\n", (mode & 040000) ? "Repertoire" : "Fichier", name);
+    return inode_num;
+}
+
+
+/**
+ * @brief Cree une entree name dans le repertoire dir_inode, deja resolu.
+ * 
+ * Le nom doit etre absent du repertoire; les permissions ne sont pas
+ * verifiees et rien n'est affiche en cas de succes.
+ * 
+ * @param part Pointeur vers la partition.
+ * @param dir_inode Numero d'inode du repertoire parent.
+ * @param name Nom de l'entree (sans '/').
+ * @param mode Mode du fichier (permissions et type).
+ * @return int Le numero d'inode du fichier cree, ou -1 en cas d'erreur.
+ */
+int create_in_dir(partition_t *part, int dir_inode, const char *name, int mode) {
     // Allouer un nouvel inode
     int inode_num = allocate_inode(part);
     if (inode_num == -1) {
@@ -118,41 +156,33 @@ int create_file(partition_t *part, const char *name, int mode) {
         }
         
         part->inodes[inode_num].direct_blocks[0] = block_num;
-        part->inodes[inode_num].size = 2 * sizeof(dir_entry_t);  // . et ..
-        
-        // Initialiser le contenu du repertoire
-        dir_entry_t *dir_entries = (dir_entry_t *)(part->space->data + (block_num+ USERSAPCE_OFSET) * BLOCK_SIZE);
-        
-        // Entree pour .
-        dir_entries[0].inode_num = inode_num;
-        strcpy(dir_entries[0].name, ".");
+        part->inodes[inode_num].dir_blocks = 1;
+        part->inodes[inode_num].dir_count = 2;  // . et ..
+        part->inodes[inode_num].size = DIR_REC_LEN(1) + DIR_REC_LEN(2);  // . et ..
         
-        // Entree pour ..
-        dir_entries[1].inode_num = part->current_dir_inode;
-        strcpy(dir_entries[1].name, "..");
-        
-        // Initialiser le reste du bloc
-        for (int i = 2; i < BLOCK_SIZE / sizeof(dir_entry_t); i++) {
-            dir_entries[i].inode_num = 0;
-            memset(dir_entries[i].name, 0, MAX_NAME_LENGTH);
-        }
+        // Initialiser le contenu du repertoire: un bloc vide, puis . et ..
+        char *block = block_ptr(part, block_num);
+        int offset;
+        dir_block_init(part, block);
+        dir_block_insert(part, block, ".", inode_num, &offset);
+        dir_block_insert(part, block, "..", dir_inode, &offset);
         
         // Mettre à jour le nombre de liens
         part->inodes[inode_num].links_count = 2;  // . et entry dans le parent
-        part->inodes[part->current_dir_inode].links_count++;  // .. dans le nouveau repertoire
+        part->inodes[dir_inode].links_count++;  // .. dans le nouveau repertoire
     } else {
         // Fichier ordinaire
         part->inodes[inode_num].links_count = 1;  // Un seul lien (l'entree dans le repertoire parent)
     }
     
-    // Ajouter l'entree dans le repertoire courant
-    if (add_dir_entry(part, part->current_dir_inode, name, inode_num) != 0) {
+    // Ajouter l'entree dans le repertoire parent
+    if (add_dir_entry(part, dir_inode, name, inode_num) != 0) {
         free_inode(part, inode_num);
+        if (mode & 040000) part->inodes[dir_inode].links_count--;
         printf("Erreur: Impossible d'ajouter l'entree dans le repertoire\n");
         return -1;
     }
     
-    printf("%s '%s' cree avec succes\n", (mode & 040000) ? "Repertoire" : "Fichier", name);
     return inode_num;
 }
 
@@ -162,8 +192,9 @@ int create_file(partition_t *part, const char *name, int mode) {
  * 
  * Cette fonction cree un lien symbolique pointant vers un fichier cible. Elle verifie 
  * les permissions necessaires et si le lien ou la cible existe dejà. Un nouvel inode 
- * est alloue pour le lien symbolique et le chemin de la cible est stocke dans le 
- * bloc de donnees du lien.
+ * est alloue pour le lien symbolique et le chemin de la cible est stocke dans 
+ * l'inode lui-meme (INODE_FL_INLINE) s'il tient dans INODE_INLINE_SIZE octets, 
+ * sinon dans un bloc de donnees.
  * 
  * @param part Pointeur vers la partition où creer le lien symbolique.
  * @param link_name Nom du lien symbolique à creer.
@@ -171,21 +202,36 @@ int create_file(partition_t *part, const char *name, int mode) {
  * @return int Le numero d'inode du lien symbolique cree, ou -1 en cas d'erreur.
  */
 int create_symlink(partition_t *part, const char *link_name, const char *target_name) {
-    // Verifier les permissions du repertoire courant pour l'ecriture (bit 2)
-    if (!check_permission(part, part->current_dir_inode, 2)) {
+    // Trouver le repertoire qui recevra le lien
+    nameidata_t nd;
+    int error = namei(part, link_name, NAMEI_PARENT, &nd);
+    if (error != 0) {
+        namei_perror(error, link_name);
+        return -1;
+    }
+    int dir_inode = nd.parent;
+
+    // Verifier les permissions du repertoire parent pour l'ecriture (bit 2)
+    if (!check_permission(part, dir_inode, 2)) {
         printf("Erreur: Permissions insuffisantes pour creer dans ce repertoire\n");
         return -1;
     }
     
     // Verifier si le nom du lien existe dejà
-    if (find_file_in_dir(part, part->current_dir_inode, link_name) != -1) {
+    if (nd.inode != -1) {
         printf("Erreur: Un fichier avec ce nom existe deja\n");
         return -1;
     }
     
-    // Verifier si la cible existe
-    int target_inode = find_file_in_dir(part, part->current_dir_inode, target_name);
-    if (target_inode == -1) {
+    // Le chemin complet de la cible est stocke tel quel: il doit tenir dans un bloc
+    if ((int)strlen(target_name) >= part->block_size) {
+        printf("Erreur: Chemin cible trop long (%d octets maximum)\n", part->block_size - 1);
+        return -1;
+    }
+
+    // Verifier si la cible existe; un chemin relatif part du repertoire du lien
+    nameidata_t target_nd;
+    if (namei_at(part, dir_inode, target_name, 0, &target_nd) != 0) {
         printf("Erreur: Fichier cible '%s' non trouve\n", target_name);
         return -1;
     }
@@ -206,23 +252,27 @@ int create_symlink(partition_t *part, const char *link_name, const char *target_
     part->inodes[symlink_inode].ctime = time(NULL);
     part->inodes[symlink_inode].links_count = 1;
     
-    // Stocker le chemin de la cible dans le bloc de donnees
-    int data_block = allocate_block(part);
-    if (data_block == -1) {
-        free_inode(part, symlink_inode);
-        printf("Erreur: Plus de blocs disponibles\n");
-        return -1;
+    // Stocker le chemin de la cible dans l'inode s'il y tient, sinon dans un bloc
+    inode_t *inode = &part->inodes[symlink_inode];
+    int target_size = strlen(target_name) + 1;
+    int data_block = -1;
+    if (target_size <= INODE_INLINE_SIZE) {
+        inode->flags |= INODE_FL_INLINE;
+        memcpy(inode->inline_data, target_name, target_size);
+    } else {
+        data_block = allocate_block(part);
+        if (data_block == -1) {
+            free_inode(part, symlink_inode);
+            printf("Erreur: Plus de blocs disponibles\n");
+            return -1;
+        }
+        inode->direct_blocks[0] = data_block;
+        strcpy(block_ptr(part, data_block), target_name);
     }
+    inode->size = target_size;
     
-    part->inodes[symlink_inode].direct_blocks[0] = data_block;
-    part->inodes[symlink_inode].size = strlen(target_name) + 1;
-    
-    // Copier le nom de la cible dans le bloc de donnees
-    strcpy(part->space->data + (data_block+USERSAPCE_OFSET) * BLOCK_SIZE, target_name);
-    
-    // Ajouter l'entree dans le repertoire courant
-    if (add_dir_entry(part, part->current_dir_inode, link_name, symlink_inode) != 0) {
-        free_block(part, data_block);
+    // Ajouter l'entree dans le repertoire parent
+    if (add_dir_entry(part, dir_inode, nd.name, symlink_inode) != 0) {
         free_inode(part, symlink_inode);
         printf("Erreur: Impossible d'ajouter l'entree dans le repertoire\n");
         return -1;
@@ -248,20 +298,28 @@ int create_symlink(partition_t *part, const char *link_name, const char *target_
  * @return int 0 si la suppression a reussi, -1 en cas d'erreur.
  */
 int delete_file(partition_t *part, const char *name) {
-    // Ne pas permettre la suppression de "." et ".."
-    if (strcmp(name, ".") == 0 || strcmp(name, "..") == 0) {
+    // Trouver le repertoire qui contient l'entree
+    nameidata_t nd;
+    int error = namei(part, name, NAMEI_PARENT, &nd);
+    if (error != 0) {
+        namei_perror(error, name);
+        return -1;
+    }
+    int dir_inode = nd.parent;
+
+    // Ne pas permettre la suppression de "." et ".." (ni de la racine)
+    if (nd.name[0] == '\0' || strcmp(nd.name, ".") == 0 || strcmp(nd.name, "..") == 0) {
         printf("Erreur: Impossible de supprimer '%s'\n", name);
         return -1;
     }
     
     // Verifier les permissions du repertoire parent pour l'ecriture
-    if (!check_permission(part, part->current_dir_inode, 2)) {
+    if (!check_permission(part, dir_inode, 2)) {
         printf("Erreur: Permissions insuffisantes pour supprimer depuis ce repertoire\n");
         return -1;
     }
     
-    // Trouver le fichier dans le repertoire courant
-    int inode_num = find_file_in_dir(part, part->current_dir_inode, name);
+    int inode_num = nd.inode;
     if (inode_num == -1) {
         printf("Erreur: Fichier '%s' non trouve\n", name);
         return -1;
@@ -269,26 +327,14 @@ int delete_file(partition_t *part, const char *name) {
     
     // Verifier si c'est un repertoire et s'il est vide
     if (part->inodes[inode_num].mode & 040000) {
-        // Parcourir le contenu du repertoire pour voir s'il est vide
-        for (int i = 0; i < NUM_DIRECT_BLOCKS; i++) {
-            int block_num = part->inodes[inode_num].direct_blocks[i];
-            if (block_num == -1) continue;
-            
-            dir_entry_t *dir_entries = (dir_entry_t *)(part->space->data + (block_num +USERSAPCE_OFSET) * BLOCK_SIZE);
-            int num_entries = BLOCK_SIZE / sizeof(dir_entry_t);
-            
-            for (int j = 0; j < num_entries; j++) {
-                if (dir_entries[j].inode_num != 0 && 
-                    strcmp(dir_entries[j].name, ".") != 0 && 
-                    strcmp(dir_entries[j].name, "..") != 0) {
-                    printf("Erreur: Le repertoire n'est pas vide\n");
-                    return -1;
-                }
-            }
+        // Un repertoire vide ne contient que . et ..
+        if (part->inodes[inode_num].dir_count > 2) {
+            printf("Erreur: Le repertoire n'est pas vide\n");
+            return -1;
         }
         
         // Decrements le nombre de liens du repertoire parent (lien "..")
-        part->inodes[part->current_dir_inode].links_count--;
+        part->inodes[dir_inode].links_count--;
     }
     
     // Decrements le nombre de liens
@@ -300,334 +346,236 @@ int delete_file(partition_t *part, const char *name) {
     }
     
     // Supprimer l'entree du repertoire
-    remove_dir_entry(part, part->current_dir_inode, name);
+    remove_dir_entry(part, dir_inode, nd.name);
     
     printf("%s '%s' suppression avec succes\n", (part->inodes[inode_num].mode & 040000) ? "Repertoire" : "Fichier", name);
     return 0;
 }
 
 /**
- * @brief Resout un lien symbolique en suivant les redirections jusqu'à ce qu'un fichier ou repertoire reel soit atteint.
+ * @brief Lit le contenu d'un fichier et le copie dans un buffer.
  * 
- * Cette fonction limite la profondeur de resolution à 10 pour eviter les boucles infinies.
- * Si un lien symbolique est trouve, la fonction suit la cible du lien jusqu'à ce qu'un fichier
- * ou repertoire reel soit atteint. Si un lien corrompu est detecte ou si un trop grand nombre
- * de niveaux de liens symboliques est rencontre, la fonction retourne une erreur.
+ * Cette fonction lit un fichier à partir du système de fichiers et le copie dans un tampon. 
+ * Si le fichier est un lien symbolique, il est d'abord resolu. Elle verifie egalement si 
+ * l'utilisateur dispose des permissions necessaires pour lire le fichier.
  * 
  * @param part Partition contenant les informations sur les inodes et l'espace de donnees.
- * @param inode_num Numero de l'inode du fichier ou repertoire à partir duquel commencer la resolution.
+ * @param name Le nom du fichier à lire.
+ * @param buffer Le tampon où les donnees lues seront copiees.
+ * @param max_size La taille maximale à lire.
  * 
- * @return L'inode correspondant à la cible du lien symbolique, ou -1 en cas d'erreur.
+ * @return Le nombre d'octets effectivement lus, ou -1 si le fichier n'a pas ete trouve, ou -2 si les permissions sont insuffisantes.
  */
-int resolve_symlink(partition_t *part, int inode_num) {
-    int max_depth = 10;  // Limiter la profondeur pour eviter les boucles infinies
-    
-    for (int depth = 0; depth < max_depth; depth++) {
-
-        if ((part->inodes[inode_num].mode & 0170000)!=0120000) { 
-            return inode_num;
-        }
-        
-        int data_block = part->inodes[inode_num].direct_blocks[0];
-        if (data_block == -1) {
-            return -1;  // Lien corrompu
-        }
-        
-        char target_name[MAX_NAME_LENGTH];
-        strncpy(target_name, part->space->data +( data_block+USERSAPCE_OFSET) * BLOCK_SIZE, MAX_NAME_LENGTH - 1);
-        target_name[MAX_NAME_LENGTH - 1] = '\0';
 
-        int target_inode = find_file_in_dir(part, part->current_dir_inode, target_name);
-        if (target_inode == -1) {
-            printf("Erreur: Cible du lien '%s' non trouvee\n", target_name);
-            return -1;
-        }
-        
-        inode_num = target_inode;
-    }
-    
-    printf("Erreur: Trop de niveaux de liens symboliques\n");
-    return -1;
+int read_from_file(partition_t *part, const char *name, char *buffer, int max_size) {
+    return pread_file(part, name, buffer, max_size, 0);
 }
 
+
 /**
- * @brief Resout un chemin absolu et retourne l'inode correspondant au fichier ou repertoire.
+ * @brief Lit une partie d'un fichier, à partir d'une position donnee.
  * 
- * Cette fonction resout un chemin absolu (commençant par '/') en parcourant les repertoires
- * et en suivant les liens symboliques eventuels. Si un lien symbolique est rencontre,
- * il est resolu jusqu'à ce qu'un fichier reel soit trouve. La fonction verifie egalement
- * les permissions necessaires pour acceder aux repertoires.
+ * Seuls les blocs qui contiennent [offset, offset + size) sont lus.
  * 
- * @param part Partition contenant les informations sur les inodes et l'espace de donnees.
- * @param path Le chemin absolu à resoudre.
+ * @param part Partition contenant le fichier.
+ * @param name Chemin du fichier (les liens symboliques sont suivis).
+ * @param buffer Le tampon où les donnees lues seront copiees.
+ * @param size Nombre d'octets à lire.
+ * @param offset Position du premier octet à lire.
  * 
- * @return L'inode correspondant au fichier ou repertoire à la fin du chemin, ou -1 en cas d'erreur.
+ * @return Le nombre d'octets lus (0 au-delà de la fin), -1 si le fichier n'a pas ete trouve
+ *         ou si les arguments sont invalides, ou -2 si les permissions sont insuffisantes.
  */
+int pread_file(partition_t *part, const char *name, char *buffer, int size, int offset) {
+    nameidata_t nd;
+    int error = namei(part, name, NAMEI_FOLLOW, &nd);
+    if (error == NAMEI_EACCES) return -2;
+    if (error != 0) return -1;
+    if (!check_permission(part, nd.inode, 4)) return -2;
+    
+    int bytes_read = inode_pread(part, nd.inode, buffer, size, offset, NULL);
+    part->inodes[nd.inode].atime = time(NULL);
+    return bytes_read;
+}
 
-int resolve_pathAB(partition_t *part, const char *path) {
-    // Verifier si le chemin est absolu (commence par '/')
-    if (path == NULL || path[0] != '/') {
-        printf("Erreur: Chemin non absolu\n");
+
+/**
+ * @brief Trouve (ou cree) le fichier ordinaire à ecrire et verifie le droit d'ecriture.
+ * 
+ * @return L'inode du fichier, -1 en cas d'erreur, ou -2 si les permissions sont insuffisantes.
+ */
+static int resolve_for_write(partition_t *part, const char *name) {
+    nameidata_t nd;
+    int error = namei(part, name, NAMEI_FOLLOW | NAMEI_PARENT, &nd);
+    if (error == NAMEI_EACCES) return -2;
+    if (error != 0) {
+        namei_perror(error, name);
         return -1;
     }
-    
-    // Commencer à la racine
-    int current_inode = 1;
-    
-    // Si le chemin est juste "/", retourner l'inode de la racine
-    if (strlen(path) == 1) {
-        return current_inode;
+    int inode_num = nd.inode;
+    if (inode_num < 0) {
+        inode_num = create_file(part, name, 0100644); // -rw-r--r--
+        if (inode_num < 0) return -1;
     }
-    
-    // Faire une copie du chemin pour la tokenisation
-    char path_copy[MAX_NAME_LENGTH * 4];
-    strncpy(path_copy, path + 1, sizeof(path_copy) - 1); // +1 pour sauter le '/' initial
-    path_copy[sizeof(path_copy) - 1] = '\0';
-    
-    // Separer le chemin en composants
-    char *token = strtok(path_copy, "/");
-    
-    while (token != NULL) {
-        // Sauter les composants "." (repertoire courant)
-        if (strcmp(token, ".") == 0) {
-            token = strtok(NULL, "/");
-            continue;
-        }
-        
-        // Gerer ".." (repertoire parent)
-        if (strcmp(token, "..") == 0) {
-            // Trouver l'inode parent en utilisant l'entree ".."
-            int parent_inode = -1;
-            
-            for (int i = 0; i < NUM_DIRECT_BLOCKS; i++) {
-                int block_num = part->inodes[current_inode].direct_blocks[i];
-                if (block_num == -1) continue;
-                
-                // Calculer l'offset reel dans l'espace de donnees
-                // Assurez-vous que vous utilisez la bonne façon d'acceder aux blocs
-                int real_block_offset = (block_num + USERSAPCE_OFSET) * BLOCK_SIZE;
-                dir_entry_t *dir_entries = (dir_entry_t *)(part->space->data + real_block_offset);
-                int num_entries = BLOCK_SIZE / sizeof(dir_entry_t);
-                
-                for (int j = 0; j < num_entries; j++) {
-                    if (dir_entries[j].inode_num != 0 && strcmp(dir_entries[j].name, "..") == 0) {
-                        parent_inode = dir_entries[j].inode_num;
-                        break;
-                    }
-                }
-                if (parent_inode != -1) break;
-            }
-            
-            if (parent_inode == -1) {
-                printf("Erreur: Impossible de trouver le repertoire parent\n");
-                return -1;
-            }
-            
-            // Verifier les permissions
-            if (!check_permission(part, parent_inode, 1)) {  // Besoin de permission d'execution
-                printf("Erreur: Permissions insuffisantes pour acceder au repertoire parent\n");
-                return -1;
-            }
-            
-            current_inode = parent_inode;
-        }
-        // Gerer un composant normal du chemin
-        else {
-
-            printf("hiii %d  %s",current_inode,token);
-            // Chercher ce composant dans le repertoire courant
-            int inode_num = find_file_in_dir(part, current_inode, token);
-            if (inode_num == -1) {
-                printf("Erreur: '%s' non trouve\n", token);
-                return -1;
-            }
-            
-            // Si c'est un lien symbolique, le resoudre
-            if (part->inodes[inode_num].mode & 0120000) {
-                printf("Suivi du lien symbolique '%s'...\n", token);
-                inode_num = resolve_symlink(part, inode_num);
-                if (inode_num == -1) {
-                    return -1;
-                }
-            }
-            
-            // Verifier les permissions (sauf pour le dernier composant du chemin)
-            char *next_token = strtok(NULL, "/");
-            if (next_token != NULL) {
-                // Ce n'est pas le dernier composant, nous avons besoin de permission d'execution
-                // Verifier si c'est un repertoire
-                if (!(part->inodes[inode_num].mode & 040000)) {
-                    printf("Erreur: '%s' n'est pas un repertoire\n", token);
-                    return -1;
-                }
-                
-                if (!check_permission(part, inode_num, 1)) {  // Besoin de permission d'execution
-                    printf("Erreur: Permissions insuffisantes pour acceder à '%s'\n", token);
-                    return -1;
-                }
-            }
-            // Si c'est le dernier composant, ne pas verifier s'il s'agit d'un repertoire
-            
-            // Mettre à jour l'inode courant
-            current_inode = inode_num;
-            
-            // Remettre le token pour le prochain tour
-            token = next_token;
-            continue;
-        }
-        
-        // Passer au composant suivant
-        token = strtok(NULL, "/");
+    if ((part->inodes[inode_num].mode & 0170000) == 040000) {
+        printf("Erreur: '%s' est un repertoire\n", name);
+        return -1;
     }
-    
-    // Mettre à jour le temps d'accès
-    part->inodes[current_inode].atime = time(NULL);
-    
-    return current_inode;
+    if (!check_permission(part, inode_num, 2)) return -2;
+    return inode_num;
 }
 
 
 /**
- * @brief Resout un lien symbolique en suivant sa cible.
+ * @brief Ecrit dans un fichier à partir d'une position donnee, sans reecrire le reste.
  * 
- * Cette fonction verifie si un inode correspond à un lien symbolique. Si oui, elle resout
- * le lien symbolique et retourne l'inode du fichier cible. Sinon, elle retourne l'inode
- * d'origine.
+ * Le contenu existant est garde: seuls les blocs couverts par l'ecriture sont
+ * modifies, et des blocs ne sont alloues que si le fichier grandit. Le fichier est cree s'il n'existe pas.
  * 
- * @param part Partition contenant les informations sur les inodes et l'espace de donnees.
- * @param symlink_inode Numero de l'inode du lien symbolique à resoudre.
+ * @param part Partition contenant le fichier.
+ * @param name Chemin du fichier (les liens symboliques sont suivis).
+ * @param data Les donnees à ecrire.
+ * @param size Nombre d'octets à ecrire.
+ * @param offset Position du premier octet à ecrire (au-delà de la fin, l'ecart se lit comme des zeros).
  * 
- * @return L'inode de la cible du lien symbolique ou l'inode d'origine si ce n'est pas un lien symbolique, ou -1 en cas d'erreur.
+ * @return Le nombre d'octets ecrits, -1 en cas d'erreur, ou -2 si les permissions sont insuffisantes.
  */
-
-int resolve_symlink2(partition_t *part, int symlink_inode) {
-    // Check if it's a symlink
-    if (!(part->inodes[symlink_inode].mode & 0120000)) {
-        return symlink_inode; // Not a symlink, return as is
-    }
-    
-    // Read the target path
-    int data_block = part->inodes[symlink_inode].direct_blocks[0];
-    if (data_block == -1) return -1;
-    
-    char target_path[MAX_NAME_LENGTH];
-    strcpy(target_path, part->space->data + (data_block + USERSAPCE_OFSET) * BLOCK_SIZE);
+int pwrite_file(partition_t *part, const char *name, const char *data, int size, int offset) {
+    int inode_num = resolve_for_write(part, name);
+    if (inode_num < 0) return inode_num;
     
-    // Find the target file
-    return find_file_in_dir(part, part->current_dir_inode, target_path);
+    return inode_pwrite(part, inode_num, data, size, offset, NULL);
 }
 
+
 /**
- * @brief Lit le contenu d'un fichier et le copie dans un buffer.
+ * @brief Ajoute des donnees à la fin d'un fichier.
  * 
- * Cette fonction lit un fichier à partir du système de fichiers et le copie dans un tampon. 
- * Si le fichier est un lien symbolique, il est d'abord resolu. Elle verifie egalement si 
- * l'utilisateur dispose des permissions necessaires pour lire le fichier.
+ * L'ecriture commence dans le dernier bloc, là où le fichier s'arrete, et
+ * n'alloue de blocs que pour ce qui depasse: le coût depend des octets
+ * ajoutes, pas de la taille du fichier. Le fichier est cree s'il n'existe pas.
  * 
- * @param part Partition contenant les informations sur les inodes et l'espace de donnees.
- * @param name Le nom du fichier à lire.
- * @param buffer Le tampon où les donnees lues seront copiees.
- * @param max_size La taille maximale à lire.
+ * @param part Partition contenant le fichier.
+ * @param name Chemin du fichier (les liens symboliques sont suivis).
+ * @param data Les donnees à ajouter.
+ * @param size Nombre d'octets à ajouter.
  * 
- * @return Le nombre d'octets effectivement lus, ou -1 si le fichier n'a pas ete trouve, ou -2 si les permissions sont insuffisantes.
+ * @return Le nombre d'octets ecrits, -1 en cas d'erreur, ou -2 si les permissions sont insuffisantes.
  */
-
-int read_from_file(partition_t *part, const char *name, char *buffer, int max_size) {
-
-    // Trouver l'inode du fichier
-    int inode_num = find_file_in_dir(part, part->current_dir_inode, name);
-    if (inode_num < 0) return -1; // Fichier non trouve
-    
-    if ((part->inodes[inode_num].mode & 0170000) == 0120000) {
-        inode_num = resolve_symlink2(part, inode_num);
-        if (inode_num < 0) return -1; // Failed to resolve symlink
-    }
-
-    // Verifier les permissions de lecture
-    if (!check_permission(part, inode_num, 4)) return -2; // Pas de permission
-    
-    // Determiner la taille à lire
-    int size_to_read = (part->inodes[inode_num].size < max_size) ? 
-                        part->inodes[inode_num].size : max_size;
+int append_to_file(partition_t *part, const char *name, const char *data, int size) {
+    int inode_num = resolve_for_write(part, name);
+    if (inode_num < 0) return inode_num;
     
-    int remaining = size_to_read;
-    int offset = 0;
-    
-    // Lire les donnees depuis les blocs directs
-    for (int i = 0; i < NUM_DIRECT_BLOCKS && remaining > 0; i++) {
-        int block_num = part->inodes[inode_num].direct_blocks[i];
-        if (block_num == -1) break;
-        
-        int read_size = (remaining > BLOCK_SIZE) ? BLOCK_SIZE : remaining;
-        
-        // Copier les donnees du bloc vers le buffer
-        memcpy(buffer + offset, part->space->data + (block_num + USERSAPCE_OFSET) * BLOCK_SIZE, read_size);
-        
-        offset += read_size;
-        remaining -= read_size;
-    }
-    
-    // Mettre à jour le temps d'accès
-    part->inodes[inode_num].atime = time(NULL);
-    
-    return size_to_read - remaining;
+    return inode_pwrite(part, inode_num, data, size, part->inodes[inode_num].size, NULL);
 }
 
 /**
- * @brief Affiche le contenu d'un fichier dans la sortie standard (simule la commande 'cat').
+ * @brief Ecrit tous les octets decrits par iov sur fd, en reprenant apres une ecriture partielle.
  * 
- * Cette fonction utilise `read_from_file` pour lire le contenu d'un fichier et l'afficher à l'ecran.
- * Si une erreur se produit, un message d'erreur est affiche.
- * 
- * @param part Partition contenant les informations sur les inodes et l'espace de donnees.
- * @param name Le nom du fichier à afficher.
+ * @return 0 en cas de succès, -1 si l'ecriture a echoue.
  */
-
-void cat_command(partition_t *part, const char *name) {
-    // Tampon pour stocker le contenu du fichier
-    char buffer[10240]; // Maximum de 10Ko pour cet exemple
-    
-    int bytes_read = read_from_file(part, name, buffer, sizeof(buffer) - 1);
-    if (bytes_read > 0) {
-        buffer[bytes_read] = '\0'; // Ajouter un terminateur de chaîne
-        printf("%s\n", buffer);
-    } else if (bytes_read == -1) {
-        printf("Erreur: fichier '%s' non trouve.\n", name);
-    } else if (bytes_read == -2) {
-        printf("Erreur: permission refusee pour '%s'.\n", name);
+static int write_iovecs(int fd, struct iovec *iov, int count) {
+    while (count > 0) {
+        ssize_t n = writev(fd, iov, count);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        // Sauter les tampons entierement ecrits, puis avancer dans le suivant
+        while (count > 0 && (size_t)n >= iov->iov_len) {
+            n -= iov->iov_len;
+            iov++;
+            count--;
+        }
+        if (count > 0) {
+            iov->iov_base = (char *)iov->iov_base + n;
+            iov->iov_len -= n;
+        }
     }
-
-
+    return 0;
 }
 
 
 /**
- * @brief ecrit du contenu dans un fichier, simule la commande 'cat >'.
+ * @brief Affiche le contenu d'un fichier dans la sortie standard (simule la commande 'cat').
  * 
- * Cette fonction utilise une fonction d'ecriture pour placer le contenu dans un fichier donne.
- * Si une erreur se produit lors de l'ecriture ou si les permissions sont insuffisantes,
- * un message d'erreur est affiche.
+ * Le contenu n'est pas recopie: les blocs sont ecrits directement depuis
+ * l'espace de la partition avec writev, une suite de blocs contigus formant
+ * un seul tampon, par lots de CAT_IOVECS tampons. Le fichier est donc affiche
+ * en entier, quelle que soit sa taille et meme s'il contient des '\0'. Un trou
+ * s'affiche comme des zeros.
+ * Si une erreur se produit, un message d'erreur est affiche; si c'est
+ * l'ecriture sur la sortie qui echoue, une seule fois (avec perror) et sans
+ * le saut de ligne final.
  * 
  * @param part Partition contenant les informations sur les inodes et l'espace de donnees.
- * @param name Le nom du fichier où le contenu doit être ecrit.
- * @param content Le contenu à ecrire dans le fichier.
- * 
- * @return 0 si l'ecriture a reussi, ou 1 si une erreur est survenue.
+ * @param name Le nom du fichier à afficher.
  */
 
-int cat_write_command(partition_t *part, const char *name, const char *content) {
-    int bytes_written = write_to_file(part, name, content, strlen(content));
-    if(bytes_written<0)
-    if (bytes_written == -1) {
-        printf("Erreur lors de l'ecriture dans '%s'.\n", name);
-        return 1;
-    } else if (bytes_written==-2){
+void cat_command(partition_t *part, const char *name) {
+    static const char zeros[MAX_BLOCK_SIZE];
+    
+    nameidata_t nd;
+    int error = namei(part, name, NAMEI_FOLLOW, &nd);
+    if (error == NAMEI_EACCES || (error == 0 && !check_permission(part, nd.inode, 4))) {
         printf("Erreur: permission refusee pour '%s'.\n", name);
-        return 1;
+        return;
+    }
+    if (error != 0) {
+        namei_perror(error, name);
+        return;
+    }
+    int inode_num = nd.inode;
+    inode_t *inode = &part->inodes[inode_num];
+    if ((inode->mode & 0170000) == 040000) {
+        printf("Erreur: '%s' est un repertoire.\n", name);
+        return;
+    }
+    inode->atime = time(NULL);
+    if (inode->size == 0) return;
+    
+    // Ce qui a deja ete affiche avec printf doit sortir avant le contenu
+    fflush(stdout);
+    
+    struct iovec iov[CAT_IOVECS];
+    int count = 0;
+    int failed = 0;
+    if (inode->flags & INODE_FL_INLINE) {
+        iov[count].iov_base = inode->inline_data;
+        iov[count].iov_len = inode->size;
+        count++;
     } else {
-        printf("%d octets ecrits dans '%s'.\n", bytes_written, name);
+        block_map_cache_t cache = BLOCK_MAP_CACHE_INIT;
+        int num_blocks = (inode->size + part->block_size - 1) / part->block_size;
+        int prev = -2;  // Bloc logique du dernier bloc ajoute à iov[count - 1]
+        for (int i = 0; i < num_blocks && !failed; i++) {
+            int len = (i == num_blocks - 1) ? inode->size - i * part->block_size : part->block_size;
+            int block_num = inode_bmap(part, inode_num, i, 0, &cache);
+            
+            // Bloc qui suit le precedent dans l'espace: prolonger le tampon
+            if (block_num != -1 && block_num == prev + 1 && count > 0) {
+                iov[count - 1].iov_len += len;
+                prev = block_num;
+                continue;
+            }
+            if (count == CAT_IOVECS) {
+                failed = write_iovecs(STDOUT_FILENO, iov, count) != 0;
+                count = 0;
+            }
+            iov[count].iov_base = block_num == -1 ? (void *)zeros : block_ptr(part, block_num);
+            iov[count].iov_len = len;
+            count++;
+            prev = block_num == -1 ? -2 : block_num;
+        }
     }
-    return 0;
+    if (!failed && count > 0) {
+        failed = write_iovecs(STDOUT_FILENO, iov, count) != 0;
+    }
+    if (failed) {
+        perror("Erreur: Affichage du fichier interrompu");
+        return;
+    }
+    printf("\n");
 }
 
 
@@ -643,15 +591,13 @@ int cat_write_command(partition_t *part, const char *name, const char *content)
  * @return int Retourne 0 si la creation du lien dur est reussie, -1 en cas d'erreur.
  */
 int create_hard_link(partition_t *part, const char *target_path, const char *link_path) {
-    int target_parent_inode = -1;
-    int link_parent_inode = -1;
-    
     // Resoudre le chemin de la cible
-    int target_inode = resolve_path(part, target_path, &target_parent_inode);
-    if (target_inode == -1) {
+    nameidata_t target_nd;
+    if (namei(part, target_path, 0, &target_nd) != 0) {
         printf("Erreur: Fichier cible '%s' non trouve\n", target_path);
         return -1;
     }
+    int target_inode = target_nd.inode;
     
     // Verifier si la cible est un repertoire
     if (part->inodes[target_inode].mode & 040000) {
@@ -659,184 +605,150 @@ int create_hard_link(partition_t *part, const char *target_path, const char *lin
         return -1;
     }
     
-    // Resoudre le chemin parent du lien
-    char link_parent_path[MAX_NAME_LENGTH * 4];
-    char link_name[MAX_NAME_LENGTH];
-    
-    // Extraire le nom du lien et le chemin de son parent
-    const char *last_slash = strrchr(link_path, '/');
-    if (last_slash == NULL) {
-        // Chemin relatif sans slash, utiliser le repertoire courant
-        strcpy(link_parent_path, ".");
-        strcpy(link_name, link_path);
-    } else if (last_slash == link_path) {
-        // Lien dans la racine
-        strcpy(link_parent_path, "/");
-        strcpy(link_name, last_slash + 1);
-    } else {
-        // Extraire le chemin du parent
-        int parent_len = last_slash - link_path;
-        strncpy(link_parent_path, link_path, parent_len);
-        link_parent_path[parent_len] = '\0';
-        strcpy(link_name, last_slash + 1);
-    }
-    
-    // Resoudre le repertoire parent du lien
-    int link_dir_inode = resolve_path(part, link_parent_path, &link_parent_inode);
-    if (link_dir_inode == -1) {
-        printf("Erreur: Repertoire parent du lien '%s' non trouve\n", link_parent_path);
-        return -1;
-    }
-    
-    // Verifier si le repertoire parent du lien est bien un repertoire
-    if (!(part->inodes[link_dir_inode].mode & 040000)) {
-        printf("Erreur: '%s' n'est pas un repertoire\n", link_parent_path);
+    // Resoudre le repertoire parent du lien et le nom du lien
+    nameidata_t link_nd;
+    int error = namei(part, link_path, NAMEI_PARENT, &link_nd);
+    if (error != 0) {
+        namei_perror(error, link_path);
         return -1;
     }
+    int link_dir_inode = link_nd.parent;
     
     // Verifier si l'utilisateur a les droits d'ecriture sur le repertoire parent du lien
     if (!check_permission(part, link_dir_inode, 2)) {
-        printf("Erreur: Permission d'ecriture refusee pour '%s'\n", link_parent_path);
+        printf("Erreur: Permission d'ecriture refusee pour '%s'\n", link_path);
         return -1;
     }
     
     // Verifier si un fichier avec le même nom existe dejà dans le repertoire parent du lien
-    if (find_file_in_dir(part, link_dir_inode, link_name) != -1) {
-        printf("Erreur: '%s' existe dejà\n", link_name);
+    if (link_nd.inode != -1) {
+        printf("Erreur: '%s' existe dejà\n", link_nd.name);
         return -1;
     }
     
-    // Trouver un bloc libre pour ajouter l'entree de repertoire
-    int dir_block = -1;
-    int entry_index = -1;
+    // Ajouter l'entree de repertoire pour le nouveau lien dur
+    if (add_dir_entry(part, link_dir_inode, link_nd.name, target_inode) != 0) {
+        printf("Erreur: Repertoire plein, impossible d'ajouter une nouvelle entree\n");
+        return -1;
+    }
     
-    for (int i = 0; i < NUM_DIRECT_BLOCKS; i++) {
-        int block_num = part->inodes[link_dir_inode].direct_blocks[i];
-        if (block_num == -1) {
-            // Allouer un nouveau bloc
-            block_num = allocate_block(part);
-            if (block_num == -1) {
-                printf("Erreur: Plus de blocs disponibles\n");
-                return -1;
-            }
-            part->inodes[link_dir_inode].direct_blocks[i] = block_num;
-            
-            // Initialiser le nouveau bloc
-            memset(part->space->data + (block_num + USERSAPCE_OFSET) * BLOCK_SIZE, 0, BLOCK_SIZE);
-            
-            dir_block = block_num;
-            entry_index = 0;
-            break;
-        }
-        
-        // Chercher une entree libre dans le bloc existant
-        dir_entry_t *dir_entries = (dir_entry_t *)(part->space->data + (block_num + USERSAPCE_OFSET) * BLOCK_SIZE);
-        int num_entries = BLOCK_SIZE / sizeof(dir_entry_t);
+    // Incrementer le nombre de liens dans l'inode cible
+    part->inodes[target_inode].links_count++;
+    
+    printf("Lien dur '%s' cree vers '%s'\n", link_path, target_path);
+    return 0;
+}
+
+
+/**
+ * @brief Ajoute un numero d'inode à un tableau qui grandit à la demande.
+ * 
+ * @return 0, ou -1 si la memoire manque.
+ */
+static int inode_list_push(int **list, int *count, int *cap, int inode_num) {
+    if (*count == *cap) {
+        int new_cap = *cap != 0 ? *cap * 2 : 64;
+        int *new_list = (int *)realloc(*list, new_cap * sizeof(int));
+        if (new_list == NULL) return -1;
+        *list = new_list;
+        *cap = new_cap;
+    }
+    (*list)[(*count)++] = inode_num;
+    return 0;
+}
+
+
+/**
+ * @brief Inventorie un sous-arbre sans le modifier.
+ * 
+ * Le parcours est iteratif: la liste des repertoires sert aussi de liste de
+ * travail (chaque repertoire trouve y est ajoute puis lu à son tour). Il se fait
+ * par inodes, sans construire ni resoudre le chemin d'aucun descendant. Chaque
+ * repertoire non vide doit etre accessible en ecriture.
+ * 
+ * @param part Partition contenant le sous-arbre.
+ * @param root Repertoire racine du sous-arbre.
+ * @param path Chemin de la racine, pour les messages.
+ * @param dirs Reçoit les repertoires (racine comprise), à liberer par l'appelant.
+ * @param num_dirs Reçoit le nombre de repertoires.
+ * @param files Reçoit une case par entree qui n'est pas un repertoire (un fichier
+ *              lie deux fois y figure deux fois), à liberer par l'appelant.
+ * @param num_files Reçoit le nombre d'entrees de files.
+ * @return 0 en cas de succès, -1 en cas d'erreur (rien n'a ete modifie).
+ */
+static int collect_subtree(partition_t *part, int root, const char *path,
+                           int **dirs, int *num_dirs, int **files, int *num_files) {
+    int dirs_cap = 0, files_cap = 0;
+    *dirs = NULL;
+    *files = NULL;
+    *num_dirs = 0;
+    *num_files = 0;
+    if (inode_list_push(dirs, num_dirs, &dirs_cap, root) != 0) goto out_of_memory;
+    
+    for (int d = 0; d < *num_dirs; d++) {
+        int dir_inode = (*dirs)[d];
+        if (part->inodes[dir_inode].dir_count <= 2) continue;  // Seulement . et ..
         
-        for (int j = 0; j < num_entries; j++) {
-            if (dir_entries[j].inode_num == 0) {
-                dir_block = block_num;
-                entry_index = j;
-                break;
-            }
+        if (!check_permission(part, dir_inode, 2)) {
+            printf("Erreur: Permissions insuffisantes pour supprimer le contenu d'un repertoire de '%s'\n", path);
+            return -1;
         }
         
-        if (dir_block != -1) break;
-    }
-    
-    // Si aucun bloc direct n'a d'espace, essayer le bloc indirect
-    if (dir_block == -1) {
-        // Si pas de bloc indirect, en allouer un
-        if (part->inodes[link_dir_inode].indirect_block == -1) {
-            int indirect_block = allocate_block(part);
-            if (indirect_block == -1) {
-                printf("Erreur: Plus de blocs disponibles\n");
-                return -1;
-            }
-            part->inodes[link_dir_inode].indirect_block = indirect_block;
+        block_map_cache_t cache = BLOCK_MAP_CACHE_INIT;
+        for (int i = 0; i < part->inodes[dir_inode].dir_blocks; i++) {
+            int block_num = inode_bmap(part, dir_inode, i, 0, &cache);
+            if (block_num == -1) continue;
             
-            // Initialiser la table indirecte
-            int *indirect_table = (int *)(part->space->data + (indirect_block + USERSAPCE_OFSET) * BLOCK_SIZE);
-            for (int i = 0; i < BLOCK_SIZE / sizeof(int); i++) {
-                indirect_table[i] = -1;
-            }
-        }
-        
-        // Parcourir la table indirecte
-        int *indirect_table = (int *)(part->space->data + (part->inodes[link_dir_inode].indirect_block + USERSAPCE_OFSET) * BLOCK_SIZE);
-        for (int i = 0; i < BLOCK_SIZE / sizeof(int); i++) {
-            if (indirect_table[i] == -1) {
-                // Allouer un nouveau bloc
-                int block_num = allocate_block(part);
-                if (block_num == -1) {
-                    printf("Erreur: Plus de blocs disponibles\n");
-                    return -1;
-                }
-                indirect_table[i] = block_num;
+            char *block = block_ptr(part, block_num);
+            for (int off = 0; off < part->block_size; off += dir_rec_len((dir_entry_t *)(block + off))) {
+                dir_entry_t *entry = (dir_entry_t *)(block + off);
+                if (entry->inode_num == 0 || strcmp(entry->name, ".") == 0 || strcmp(entry->name, "..") == 0) continue;
                 
-                // Initialiser le nouveau bloc
-                memset(part->space->data + (block_num + USERSAPCE_OFSET) * BLOCK_SIZE, 0, BLOCK_SIZE);
-                
-                dir_block = block_num;
-                entry_index = 0;
-                break;
+                // Le type est lu dans l'entree: un lien symbolique n'est pas suivi
+                int pushed = dir_entry_type(part, entry) == DIR_FT_DIR
+                    ? inode_list_push(dirs, num_dirs, &dirs_cap, entry->inode_num)
+                    : inode_list_push(files, num_files, &files_cap, entry->inode_num);
+                if (pushed != 0) goto out_of_memory;
             }
-            
-            // Chercher une entree libre dans le bloc existant
-            dir_entry_t *dir_entries = (dir_entry_t *)(part->space->data + (indirect_table[i] + USERSAPCE_OFSET) * BLOCK_SIZE);
-            int num_entries = BLOCK_SIZE / sizeof(dir_entry_t);
-            
-            for (int j = 0; j < num_entries; j++) {
-                if (dir_entries[j].inode_num == 0) {
-                    dir_block = indirect_table[i];
-                    entry_index = j;
-                    break;
-                }
-            }
-            
-            if (dir_block != -1) break;
         }
     }
-    
-    if (dir_block == -1) {
-        printf("Erreur: Repertoire plein, impossible d'ajouter une nouvelle entree\n");
-        return -1;
-    }
-    
-    // Ajouter l'entree de repertoire pour le nouveau lien dur
-    dir_entry_t *dir_entries = (dir_entry_t *)(part->space->data + (dir_block + USERSAPCE_OFSET) * BLOCK_SIZE);
-    dir_entries[entry_index].inode_num = target_inode;
-    strncpy(dir_entries[entry_index].name, link_name, MAX_NAME_LENGTH - 1);
-    dir_entries[entry_index].name[MAX_NAME_LENGTH - 1] = '\0';
-    
-    // Incrementer le nombre de liens dans l'inode cible
-    part->inodes[target_inode].links_count++;
-    
-    // Mettre à jour le temps de modification du repertoire parent
-    part->inodes[link_dir_inode].mtime = time(NULL);
-    
-    printf("Lien dur '%s' cree vers '%s'\n", link_path, target_path);
     return 0;
+    
+out_of_memory:
+    printf("Erreur: Memoire insuffisante\n");
+    return -1;
 }
 
 
 /**
  * @brief Supprime un fichier ou un repertoire de manière recursive.
  * 
- * Cette fonction supprime un fichier ou un repertoire et son contenu, si c'est un repertoire, de manière recursive. 
- * Pour un repertoire, cette fonction va d'abord supprimer les fichiers et sous-repertoires avant de supprimer le repertoire lui-même.
+ * Le sous-arbre est d'abord inventorie par inodes (collect_subtree), sans
+ * recursion ni chemins intermediaires; une erreur à ce stade ne supprime rien.
+ * Il est ensuite detache de son parent, seule entree de repertoire effacee:
+ * les repertoires du sous-arbre sont liberes avec leur contenu, sans retirer
+ * leurs entrees une à une. Un fichier n'est libere que si plus aucun lien dur
+ * ne le reference hors du sous-arbre. Tous les inodes et blocs sont rendus
+ * aux bitmaps en un seul lot (free_inodes).
  * 
  * @param part Partition contenant les fichiers et repertoires à supprimer.
  * @param path Chemin du fichier ou repertoire à supprimer.
  * @return int Retourne 0 si la suppression est reussie, -1 en cas d'erreur.
  */
-
 int delete_recursive(partition_t *part, const char *path) {
-    int parent_inode = -1;
-    int target_inode = resolve_path(part, path, &parent_inode);
+    nameidata_t nd;
+    int error = namei(part, path, 0, &nd);
+    if (error != 0) {
+        namei_perror(error, path);
+        return -1;
+    }
+    int target_inode = nd.inode;
+    int parent_inode = nd.parent;
+    const char *target_name = nd.name;
     
-    if (target_inode == -1) {
-        printf("Erreur: '%s' n'existe pas\n", path);
+    // Ne pas permettre la suppression de "." et ".." (ni de la racine)
+    if (target_name[0] == '\0' || strcmp(target_name, ".") == 0 || strcmp(target_name, "..") == 0) {
+        printf("Erreur: Impossible de supprimer '%s'\n", path);
         return -1;
     }
     
@@ -846,130 +758,133 @@ int delete_recursive(partition_t *part, const char *path) {
         return -1;
     }
     
-    // Extraire le nom du fichier/repertoire à supprimer
-    char target_name[MAX_NAME_LENGTH];
-    const char *last_slash = strrchr(path, '/');
-    if (last_slash == NULL) {
-        strcpy(target_name, path);
+    // Inventorier le sous-arbre (un fichier seul n'a pas de sous-arbre)
+    int is_dir = (part->inodes[target_inode].mode & 0170000) == 040000;
+    int *dirs = NULL, *files = NULL;
+    int num_dirs = 0, num_files = 0;
+    if (is_dir) {
+        if (collect_subtree(part, target_inode, path, &dirs, &num_dirs, &files, &num_files) != 0) {
+            free(dirs);
+            free(files);
+            return -1;
+        }
     } else {
-        strcpy(target_name, last_slash + 1);
+        int cap = 0;
+        if (inode_list_push(&files, &num_files, &cap, target_inode) != 0) {
+            printf("Erreur: Memoire insuffisante\n");
+            return -1;
+        }
     }
     
-    // Verifier si c'est un repertoire
-    if (part->inodes[target_inode].mode & 040000) {
-        // C'est un repertoire, verifier s'il est vide
-        for (int i = 0; i < NUM_DIRECT_BLOCKS; i++) {
-            int block_num = part->inodes[target_inode].direct_blocks[i];
-            if (block_num == -1) continue;
-            
-            dir_entry_t *dir_entries = (dir_entry_t *)(part->space->data + (block_num + USERSAPCE_OFSET) * BLOCK_SIZE);
-            int num_entries = BLOCK_SIZE / sizeof(dir_entry_t);
-            
-            for (int j = 0; j < num_entries; j++) {
-                if (dir_entries[j].inode_num != 0 && 
-                    strcmp(dir_entries[j].name, ".") != 0 && 
-                    strcmp(dir_entries[j].name, "..") != 0) {
-                    // Construire le chemin complet pour l'entree
-                    char subpath[MAX_NAME_LENGTH * 2];
-                    if (strcmp(path, "/") == 0) {
-                        snprintf(subpath, sizeof(subpath), "/%s", dir_entries[j].name);
-                    } else {
-                        snprintf(subpath, sizeof(subpath), "%s/%s", path, dir_entries[j].name);
-                    }
-                    
-                    // Supprimer recursivement
-                    if (delete_recursive(part, subpath) != 0) {
-                        return -1;
-                    }
-                }
-            }
+    // Les fichiers liberes rejoindront les repertoires: reserver la place avant de modifier quoi que ce soit
+    int *freed = (int *)realloc(dirs, (num_dirs + num_files) * sizeof(int));
+    if (freed == NULL) {
+        printf("Erreur: Memoire insuffisante\n");
+        free(dirs);
+        free(files);
+        return -1;
+    }
+    int num_freed = num_dirs;
+    
+    // Detacher le sous-arbre de son parent
+    if (remove_dir_entry(part, parent_inode, target_name) != 0) {
+        printf("Erreur: Entree non trouvee dans le repertoire parent\n");
+        free(freed);
+        free(files);
+        return -1;
+    }
+    if (is_dir) {
+        part->inodes[parent_inode].links_count--;  // Lien ".." du repertoire supprime
+    }
+    
+    // Un lien de moins par entree supprimee; un fichier encore lie ailleurs est garde
+    for (int i = 0; i < num_files; i++) {
+        if (--part->inodes[files[i]].links_count == 0) {
+            freed[num_freed++] = files[i];
         }
-        
-        // Verifier egalement le bloc indirect pour les entrees de repertoire
-        if (part->inodes[target_inode].indirect_block != -1) {
-            int *indirect_table = (int *)(part->space->data + (part->inodes[target_inode].indirect_block + USERSAPCE_OFSET) * BLOCK_SIZE);
-            for (int i = 0; i < BLOCK_SIZE / sizeof(int); i++) {
-                if (indirect_table[i] == -1) continue;
-                
-                dir_entry_t *dir_entries = (dir_entry_t *)(part->space->data + (indirect_table[i] + USERSAPCE_OFSET) * BLOCK_SIZE);
-                int num_entries = BLOCK_SIZE / sizeof(dir_entry_t);
-                
-                for (int j = 0; j < num_entries; j++) {
-                    if (dir_entries[j].inode_num != 0 && 
-                        strcmp(dir_entries[j].name, ".") != 0 && 
-                        strcmp(dir_entries[j].name, "..") != 0) {
-                        // Construire le chemin complet pour l'entree
-                        char subpath[MAX_NAME_LENGTH * 2];
-                        if (strcmp(path, "/") == 0) {
-                            snprintf(subpath, sizeof(subpath), "/%s", dir_entries[j].name);
-                        } else {
-                            snprintf(subpath, sizeof(subpath), "%s/%s", path, dir_entries[j].name);
-                        }
-                        
-                        // Supprimer recursivement
-                        if (delete_recursive(part, subpath) != 0) {
-                            return -1;
-                        }
-                    }
-                }
-            }
+    }
+    free(files);
+    
+    // Le repertoire courant disparait avec le sous-arbre: remonter au parent
+    for (int i = 0; i < num_dirs; i++) {
+        if (freed[i] == part->current_dir_inode) {
+            part->current_dir_inode = parent_inode;
+            break;
         }
     }
     
-    // Diminuer le nombre de liens
-    part->inodes[target_inode].links_count--;
+    free_inodes(part, freed, num_freed);
+    free(freed);
     
-    // Si le nombre de liens est 0, liberer l'inode et les blocs associes
-    if (part->inodes[target_inode].links_count <= 0) {
-        free_inode(part, target_inode);
+    printf("'%s' supprime avec succès\n", path);
+    return 0;
+}
+
+
+/**
+ * @brief Supprime un repertoire et son contenu en differe (rm -rb).
+ * 
+ * Le repertoire est detache de son parent et note comme orphelin dans le
+ * superbloc: la commande se termine sans parcourir le sous-arbre, qui est
+ * libere ensuite par morceaux entre deux commandes (reclaim_orphans). Comme le
+ * contenu n'est pas parcouru, ses droits ne sont pas verifies: il faut etre
+ * proprietaire du repertoire supprime (ou root). Un fichier seul est supprime
+ * tout de suite, comme avec delete_recursive.
+ * 
+ * @param part Partition contenant le repertoire à supprimer.
+ * @param path Chemin du repertoire à supprimer.
+ * @return int Retourne 0 si la suppression est reussie, -1 en cas d'erreur.
+ */
+int delete_deferred(partition_t *part, const char *path) {
+    nameidata_t nd;
+    int error = namei(part, path, 0, &nd);
+    if (error != 0) {
+        namei_perror(error, path);
+        return -1;
     }
+    int target_inode = nd.inode;
+    int parent_inode = nd.parent;
     
-    // Supprimer l'entree du repertoire parent
-    for (int i = 0; i < NUM_DIRECT_BLOCKS; i++) {
-        int block_num = part->inodes[parent_inode].direct_blocks[i];
-        if (block_num == -1) continue;
-        
-        dir_entry_t *dir_entries = (dir_entry_t *)(part->space->data + (block_num + USERSAPCE_OFSET) * BLOCK_SIZE);
-        int num_entries = BLOCK_SIZE / sizeof(dir_entry_t);
-        
-        for (int j = 0; j < num_entries; j++) {
-            if (dir_entries[j].inode_num == target_inode && strcmp(dir_entries[j].name, target_name) == 0) {
-                // Effacer cette entree
-                memset(&dir_entries[j], 0, sizeof(dir_entry_t));
-                
-                // Mettre à jour le temps de modification du repertoire parent
-                part->inodes[parent_inode].mtime = time(NULL);
-                
-                printf("'%s' supprime avec succès\n", path);
-                return 0;
-            }
-        }
+    if ((part->inodes[target_inode].mode & 0170000) != 040000) {
+        return delete_recursive(part, path);
+    }
+    if (nd.name[0] == '\0' || strcmp(nd.name, ".") == 0 || strcmp(nd.name, "..") == 0) {
+        printf("Erreur: Impossible de supprimer '%s'\n", path);
+        return -1;
+    }
+    if (!check_permission(part, parent_inode, 2)) {
+        printf("Erreur: Permissions insuffisantes pour supprimer '%s'\n", path);
+        return -1;
+    }
+    if (part->current_user.id != 0 && part->current_user.id != part->inodes[target_inode].uid) {
+        printf("Erreur: Seul le proprietaire peut supprimer '%s' en differe\n", path);
+        return -1;
     }
     
-    // Verifier egalement le bloc indirect du parent
-    if (part->inodes[parent_inode].indirect_block != -1) {
-        int *indirect_table = (int *)(part->space->data + (part->inodes[parent_inode].indirect_block + USERSAPCE_OFSET) * BLOCK_SIZE);
-        for (int i = 0; i < BLOCK_SIZE / sizeof(int); i++) {
-            if (indirect_table[i] == -1) continue;
-            
-            dir_entry_t *dir_entries = (dir_entry_t *)(part->space->data + (indirect_table[i] + USERSAPCE_OFSET) * BLOCK_SIZE);
-            int num_entries = BLOCK_SIZE / sizeof(dir_entry_t);
-            
-            for (int j = 0; j < num_entries; j++) {
-                if (dir_entries[j].inode_num == target_inode && strcmp(dir_entries[j].name, target_name) == 0) {
-                    // Effacer cette entree
-                    memset(&dir_entries[j], 0, sizeof(dir_entry_t));
-                    
-                    // Mettre à jour le temps de modification du repertoire parent
-                    part->inodes[parent_inode].mtime = time(NULL);
-                    
-                    printf("'%s' supprime avec succès\n", path);
-                    return 0;
-                }
-            }
+    // Liste des orphelins pleine et impossible à vider: supprimer tout de suite
+    if (orphan_reserve(part) != 0) {
+        return delete_recursive(part, path);
+    }
+    
+    // Le repertoire courant est dans le sous-arbre: remonter au parent
+    for (int dir = part->current_dir_inode; dir != 1; ) {
+        if (dir == target_inode) {
+            part->current_dir_inode = parent_inode;
+            break;
         }
+        int up = find_file_in_dir(part, dir, "..");
+        if (up == -1 || up == dir) break;
+        dir = up;
     }
     
-    printf("Erreur: Entree non trouvee dans le repertoire parent\n");
-    return -1;
+    // Detacher le sous-arbre, puis le confier à la recuperation differee
+    if (remove_dir_entry(part, parent_inode, nd.name) != 0) {
+        printf("Erreur: Entree non trouvee dans le repertoire parent\n");
+        return -1;
+    }
+    part->inodes[parent_inode].links_count--;  // Lien ".." du repertoire supprime
+    orphan_add(part, target_inode);
+    
+    printf("'%s' supprime avec succès\n", path);
+    return 0;
 }
@@ -0,0 +1,213 @@
+/**
+ * @file file_table.c
+ * @brief Table des fichiers ouverts de la session.
+ *
+ * file_open résout le chemin et vérifie les droits une fois, puis renvoie un
+ * descripteur: un indice dans part->files. Les lectures et écritures qui
+ * suivent (file_read, file_write, file_pread, file_pwrite) utilisent
+ * directement l'inode gardé par le descripteur, avec les droits accordés à
+ * l'ouverture (comme sous UNIX, un chmod ultérieur ne les retire pas), et sa
+ * traduction de blocs: des petites lectures successives dans un même fichier
+ * ne redescendent ni le chemin ni l'arbre d'indirection. Avec OPEN_APPEND,
+ * file_write écrit à la fin du fichier, quelle que soit la position courante.
+ *
+ * La traduction gardée est oubliée quand part->map_generation change (blocs
+ * libérés ou réorganisés par ailleurs). Un fichier supprimé pendant qu'il est
+ * ouvert est détaché de ses descripteurs: leurs opérations échouent jusqu'à
+ * file_close.
+ */
+
+#include "file_table.h"
+
+
+/**
+ * @brief Descripteur ouvert et toujours attaché à son inode, ou NULL.
+ *
+ * Oublie au passage une traduction de blocs périmée.
+ */
+static file_handle_t *get_handle(partition_t *part, int fd) {
+    if (fd < 0 || fd >= MAX_OPEN_FILES) return NULL;
+    file_handle_t *h = &part->files[fd];
+    if (h->flags == 0 || h->inode_num == -1) return NULL;
+
+    if (h->map_generation != part->map_generation) {
+        h->cache.inode_num = -1;
+        h->map_generation = part->map_generation;
+    }
+    return h;
+}
+
+
+/**
+ * @brief Ouvre un fichier et renvoie son descripteur.
+ *
+ * @param part Pointeur vers la partition.
+ * @param path Chemin du fichier (les liens symboliques sont suivis).
+ * @param flags OPEN_READ et/ou OPEN_WRITE, plus OPEN_CREATE pour créer un fichier
+ *              absent, OPEN_TRUNC pour le vider et OPEN_APPEND pour que
+ *              file_write ajoute à la fin.
+ * @return Le descripteur (>= 0), -1 en cas d'erreur (fichier absent, répertoire,
+ *         table pleine), ou -2 si les permissions sont insuffisantes.
+ */
+int file_open(partition_t *part, const char *path, int flags) {
+    if ((flags & (OPEN_READ | OPEN_WRITE)) == 0) {
+        printf("Erreur: Ouverture de '%s' ni en lecture ni en ecriture\n", path);
+        return -1;
+    }
+
+    int fd = 0;
+    while (fd < MAX_OPEN_FILES && part->files[fd].flags != 0) fd++;
+    if (fd == MAX_OPEN_FILES) {
+        printf("Erreur: Trop de fichiers ouverts (%d au maximum)\n", MAX_OPEN_FILES);
+        return -1;
+    }
+
+    nameidata_t nd;
+    int error = namei(part, path, NAMEI_FOLLOW | ((flags & OPEN_CREATE) ? NAMEI_PARENT : 0), &nd);
+    if (error == NAMEI_EACCES) return -2;
+    if (error != 0) {
+        namei_perror(error, path);
+        return -1;
+    }
+    int inode_num = nd.inode;
+    if (inode_num < 0) {
+        // Creer dans le repertoire que namei vient de resoudre, sans message
+        if (!check_permission(part, nd.parent, 2)) return -2;
+        inode_num = create_in_dir(part, nd.parent, nd.name, 0100644); // -rw-r--r--
+        if (inode_num < 0) return -1;
+    }
+
+    if ((part->inodes[inode_num].mode & 0170000) == 040000) {
+        printf("Erreur: '%s' est un repertoire\n", path);
+        return -1;
+    }
+    if ((flags & OPEN_READ) && !check_permission(part, inode_num, 4)) return -2;
+    if ((flags & OPEN_WRITE) && !check_permission(part, inode_num, 2)) return -2;
+
+    if ((flags & (OPEN_WRITE | OPEN_TRUNC)) == (OPEN_WRITE | OPEN_TRUNC)) {
+        free_inode_blocks(part, inode_num);
+        part->inodes[inode_num].size = 0;
+        part->inodes[inode_num].mtime = time(NULL);
+    }
+
+    file_handle_t *h = &part->files[fd];
+    h->flags = flags & (OPEN_READ | OPEN_WRITE | OPEN_APPEND);
+    h->inode_num = inode_num;
+    h->offset = 0;
+    h->map_generation = part->map_generation;
+    h->cache.inode_num = -1;
+    part->open_files++;
+    return fd;
+}
+
+
+/**
+ * @brief Ferme un descripteur.
+ *
+ * @return 0 en cas de succès, -1 si le descripteur n'est pas ouvert.
+ */
+int file_close(partition_t *part, int fd) {
+    if (fd < 0 || fd >= MAX_OPEN_FILES || part->files[fd].flags == 0) return -1;
+    part->files[fd].flags = 0;
+    part->open_files--;
+    return 0;
+}
+
+
+/**
+ * @brief Ferme tous les descripteurs (la partition est remplacée ou libérée).
+ */
+void file_close_all(partition_t *part) {
+    for (int fd = 0; fd < MAX_OPEN_FILES; fd++) {
+        part->files[fd].flags = 0;
+    }
+    part->open_files = 0;
+}
+
+
+/**
+ * @brief Lit jusqu'à len octets à partir de offset, sans déplacer la position courante.
+ *
+ * @return Le nombre d'octets lus (0 à la fin du fichier), -1 si le descripteur
+ *         n'est pas valide, ou -2 s'il n'est pas ouvert en lecture.
+ */
+int file_pread(partition_t *part, int fd, char *buffer, int len, int offset) {
+    file_handle_t *h = get_handle(part, fd);
+    if (h == NULL) return -1;
+    if (!(h->flags & OPEN_READ)) return -2;
+
+    int bytes_read = inode_pread(part, h->inode_num, buffer, len, offset, &h->cache);
+    part->inodes[h->inode_num].atime = time(NULL);
+    return bytes_read;
+}
+
+
+/**
+ * @brief Écrit len octets à partir de offset, sans déplacer la position courante.
+ *
+ * @return Le nombre d'octets écrits, -1 en cas d'erreur (descripteur non
+ *         valide, partition pleine), ou -2 s'il n'est pas ouvert en écriture.
+ */
+int file_pwrite(partition_t *part, int fd, const char *data, int len, int offset) {
+    file_handle_t *h = get_handle(part, fd);
+    if (h == NULL) return -1;
+    if (!(h->flags & OPEN_WRITE)) return -2;
+
+    return inode_pwrite(part, h->inode_num, data, len, offset, &h->cache);
+}
+
+
+/**
+ * @brief Lit à la position courante et l'avance du nombre d'octets lus.
+ *
+ * @return Comme file_pread.
+ */
+int file_read(partition_t *part, int fd, char *buffer, int len) {
+    file_handle_t *h = get_handle(part, fd);
+    if (h == NULL) return -1;
+    int bytes_read = file_pread(part, fd, buffer, len, h->offset);
+    if (bytes_read > 0) h->offset += bytes_read;
+    return bytes_read;
+}
+
+
+/**
+ * @brief Écrit à la position courante et l'avance du nombre d'octets écrits.
+ *
+ * Avec OPEN_APPEND, l'écriture se fait à la fin du fichier et la position
+ * courante passe après les octets ajoutés.
+ *
+ * @return Comme file_pwrite.
+ */
+int file_write(partition_t *part, int fd, const char *data, int len) {
+    file_handle_t *h = get_handle(part, fd);
+    if (h == NULL) return -1;
+    if (h->flags & OPEN_APPEND) h->offset = part->inodes[h->inode_num].size;
+    int written = file_pwrite(part, fd, data, len, h->offset);
+    if (written > 0) h->offset += written;
+    return written;
+}
+
+
+/**
+ * @brief Déplace la position courante d'un descripteur.
+ *
+ * @param whence SEEK_SET, SEEK_CUR ou SEEK_END (par rapport à la taille du fichier).
+ * @return La nouvelle position, ou -1 si le descripteur n'est pas valide ou
+ *         si la position serait négative.
+ */
+int file_seek(partition_t *part, int fd, int offset, int whence) {
+    file_handle_t *h = get_handle(part, fd);
+    if (h == NULL) return -1;
+
+    long long base;
+    switch (whence) {
+        case SEEK_SET: base = 0; break;
+        case SEEK_CUR: base = h->offset; break;
+        case SEEK_END: base = part->inodes[h->inode_num].size; break;
+        default: return -1;
+    }
+    if (base + offset < 0 || base + offset > INT_MAX) return -1;
+    h->offset = (int)(base + offset);
+    return h->offset;
+}
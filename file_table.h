@@ -0,0 +1,20 @@
+#ifndef FILE_TABLE_H
+#define FILE_TABLE_H
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <time.h>
+#include "structure.h"
+#include "file_io.h"
+#include "file_operation.h"
+int file_open(partition_t *part, const char *path, int flags);
+int file_close(partition_t *part, int fd);
+void file_close_all(partition_t *part);
+int file_read(partition_t *part, int fd, char *buffer, int len);
+int file_write(partition_t *part, int fd, const char *data, int len);
+int file_pread(partition_t *part, int fd, char *buffer, int len, int offset);
+int file_pwrite(partition_t *part, int fd, const char *data, int len, int offset);
+int file_seek(partition_t *part, int fd, int offset, int whence);
+
+#endif // FILE_TABLE_H
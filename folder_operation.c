@@ -1,4 +1,55 @@
 #include "folder_operation.h"
+#include "dir_stream.h"
+#include "dir_btree.h"
+
+/** @brief Nombre d'entrées lues à chaque lot par list_directory. */
+#define LIST_BATCH_SIZE 32
+/** @brief Volume de texte en attente au-delà duquel ls l'écrit sans attendre la fin du listing. */
+#define LS_FLUSH_SIZE (1 << 20)
+
+
+/**
+ * @brief Met à jour le répertoire après l'écriture d'une entrée.
+ *
+ * Enregistre l'entrée dans l'index haché, l'oublie du cache des noms (qui
+ * pouvait la connaître comme absente), mémorise le parent d'un sous-répertoire
+ * et met à jour le nombre d'entrées, la taille et la date du répertoire.
+ */
+static void entry_written(partition_t *part, int dir_inode, dir_entry_t *entry, int pos) {
+    // Compter l'entrée avant l'index: une reconstruction se dimensionne sur dir_count
+    part->inodes[dir_inode].dir_count++;
+    dir_index_insert(part, dir_inode, entry->name, pos);
+    dcache_invalidate(part, dir_inode, entry->name);
+    // Les répertoires de l'inode 0 (caché) sont des racines: pas de parent visible
+    if (dir_inode != 0 && (part->inodes[entry->inode_num].mode & 040000) &&
+        strcmp(entry->name, ".") != 0 && strcmp(entry->name, "..") != 0) {
+        dir_parent_set(part, entry->inode_num, dir_inode, pos);
+    }
+    
+    part->inodes[dir_inode].size += DIR_REC_LEN(entry->name_len);
+    part->inodes[dir_inode].mtime = time(NULL);
+}
+
+
+/**
+ * @brief Efface une entrée et met à jour le répertoire (index, caches, indice
+ * de place libre, nombre d'entrées, taille, date).
+ */
+static void entry_cleared(partition_t *part, int dir_inode, dir_entry_t *entry, int pos) {
+    int block = pos / part->block_size;
+    if (block < part->inodes[dir_inode].dir_free_hint) {
+        part->inodes[dir_inode].dir_free_hint = block;
+    }
+    part->inodes[dir_inode].dir_count--;
+    part->inodes[dir_inode].size -= DIR_REC_LEN(entry->name_len);
+    dcache_invalidate(part, dir_inode, entry->name);
+    symlink_cache_invalidate(part);
+    dir_index_remove(part, dir_inode, entry->name, pos);
+    dir_parent_forget(part, entry->inode_num, dir_inode, pos);
+    dir_block_remove((char *)entry - pos % part->block_size, pos % part->block_size);
+    
+    part->inodes[dir_inode].mtime = time(NULL);
+}
 
 
 /**
@@ -6,12 +57,16 @@
  *
  * participation: Mestar sami:50% Tighilt idir:50%
  * Cette fonction ajoute une entrée (fichier ou sous-répertoire) dans un répertoire existant.
- * Elle vérifie si le répertoire est valide, cherche un emplacement libre dans les blocs directs,
- * et si nécessaire, utilise un bloc indirect pour allouer de l'espace. 
+ * Elle vérifie si le répertoire est valide, cherche de la place pour le nom à partir du
+ * bloc indiqué par dir_free_hint (voir dir_block_insert), et si nécessaire ajoute un bloc à
+ * la fin du répertoire. L'indice ne fait qu'avancer entre deux suppressions, une insertion
+ * coûte donc O(1) en moyenne au lieu d'un parcours de tout le répertoire. L'entrée est ensuite
+ * enregistrée dans l'index haché du répertoire (voir dir_index_insert) et oubliée du cache
+ * des noms, qui pouvait la connaître comme absente.
  *
  * @param part Partition contenant les données du système de fichiers.
  * @param dir_inode Numéro de l'inode du répertoire dans lequel l'entrée sera ajoutée.
- * @param name Nom du fichier ou sous-répertoire à ajouter.
+ * @param name Nom du fichier ou sous-répertoire à ajouter (au plus MAX_NAME_LENGTH - 1 octets).
  * @param inode_num Numéro de l'inode de l'entrée à ajouter.
  * @return Retourne 0 en cas de succès, -1 si une erreur se produit.
  */
@@ -19,113 +74,44 @@ int add_dir_entry(partition_t *part, int dir_inode, const char *name, int inode_
     if (!(part->inodes[dir_inode].mode & 040000)) {  // Vérifier si c'est un répertoire
         return -1;
     }
-    
-    // Parcourir tous les blocs du répertoire pour trouver une place libre
-    for (int i = 0; i < NUM_DIRECT_BLOCKS; i++) {
-        int block_num = part->inodes[dir_inode].direct_blocks[i];
-        if (block_num == -1) {
-            // Allouer un nouveau bloc pour le répertoire
-            block_num = allocate_block(part);
-            if (block_num == -1) return -1;  // Plus de bloc disponible
-            
-            part->inodes[dir_inode].direct_blocks[i] = block_num;
-            
-            // Initialiser le bloc avec des entrées vides
-            dir_entry_t *dir_entries = (dir_entry_t *)(part->space->data + block_num * BLOCK_SIZE);
-            int num_entries = BLOCK_SIZE / sizeof(dir_entry_t);
-            for (int j = 0; j < num_entries; j++) {
-                dir_entries[j].inode_num = 0;
-                memset(dir_entries[j].name, 0, MAX_NAME_LENGTH);
-            }
-        }
-        
-        // Chercher une entrée libre dans le bloc
-        dir_entry_t *dir_entries = (dir_entry_t *)(part->space->data + (block_num +USERSAPCE_OFSET)*BLOCK_SIZE);
-        int num_entries = BLOCK_SIZE / sizeof(dir_entry_t);
-        
-        for (int j = 0; j < num_entries; j++) {
-            if (dir_entries[j].inode_num == 0) {
-                // Entrée libre trouvée
-                dir_entries[j].inode_num = inode_num;
-                strncpy(dir_entries[j].name, name, MAX_NAME_LENGTH - 1);
-                dir_entries[j].name[MAX_NAME_LENGTH - 1] = '\0';
-                
-                // Mettre à jour la taille du répertoire
-                part->inodes[dir_inode].size += sizeof(dir_entry_t);
-                part->inodes[dir_inode].mtime = time(NULL);
-                
-                return 0;
-            }
-        }
+    if (name[0] == '\0' || strlen(name) >= MAX_NAME_LENGTH) {
+        printf("Erreur: Nom d'entree vide ou trop long (%d octets maximum)\n", MAX_NAME_LENGTH - 1);
+        return -1;
     }
-    
-    // Si on arrive ici, c'est qu'il n'y a plus de place dans les blocs directs
-    // On doit utiliser le bloc indirect
-    if (part->inodes[dir_inode].indirect_block == -1) {
-        // Allouer un bloc pour la table indirecte
-        int indirect_block = allocate_block(part);
-        if (indirect_block == -1) return -1;  // Plus de bloc disponible
-        
-        part->inodes[dir_inode].indirect_block = indirect_block;
-        
-        // Initialiser la table indirecte
-        int *indirect_table = (int *)(part->space->data + indirect_block * BLOCK_SIZE);
-        for (int i = 0; i < BLOCK_SIZE / sizeof(int); i++) {
-            indirect_table[i] = -1;
-        }
+    if ((part->inodes[dir_inode].flags & INODE_FL_DIR_BTREE) && (int)strlen(name) > dir_btree_max_name(part)) {
+        printf("Erreur: Nom trop long pour un repertoire trie (%d octets maximum)\n", dir_btree_max_name(part));
+        return -1;
     }
     
-    // Utiliser le bloc indirect
-    int *indirect_table = (int *)(part->space->data + part->inodes[dir_inode].indirect_block * BLOCK_SIZE);
-    for (int i = 0; i < BLOCK_SIZE / sizeof(int); i++) {
-        if (indirect_table[i] == -1) {
-            // Allouer un nouveau bloc pour le répertoire
-            int block_num = allocate_block(part);
-            if (block_num == -1) return -1;  // Plus de bloc disponible
-            
-            indirect_table[i] = block_num;
-            
-            // Initialiser le bloc avec des entrées vides
-            dir_entry_t *dir_entries = (dir_entry_t *)(part->space->data + (block_num +USERSAPCE_OFSET) * BLOCK_SIZE);
-            int num_entries = BLOCK_SIZE / sizeof(dir_entry_t);
-            for (int j = 0; j < num_entries; j++) {
-                dir_entries[j].inode_num = 0;
-                memset(dir_entries[j].name, 0, MAX_NAME_LENGTH);
-            }
-            
-            // Ajouter l'entrée dans le premier emplacement
-            dir_entries[0].inode_num = inode_num;
-            strncpy(dir_entries[0].name, name, MAX_NAME_LENGTH - 1);
-            dir_entries[0].name[MAX_NAME_LENGTH - 1] = '\0';
-            
-            // Mettre à jour la taille du répertoire
-            part->inodes[dir_inode].size += sizeof(dir_entry_t);
-            part->inodes[dir_inode].mtime = time(NULL);
-            
+    // Chercher de la place à partir du premier bloc qui n'était pas plein
+    int offset;
+    int dir_blocks = part->inodes[dir_inode].dir_blocks;
+    block_map_cache_t cache = BLOCK_MAP_CACHE_INIT;
+    for (int i = part->inodes[dir_inode].dir_free_hint; i < dir_blocks; i++) {
+        part->inodes[dir_inode].dir_free_hint = i;
+        int block_num = inode_bmap(part, dir_inode, i, 0, &cache);
+        if (block_num == -1) continue;
+        
+        dir_entry_t *entry = dir_block_insert(part, block_ptr(part, block_num), name, inode_num, &offset);
+        if (entry != NULL) {
+            entry_written(part, dir_inode, entry, i * part->block_size + offset);
             return 0;
-        } else {
-            // Chercher une entrée libre dans le bloc
-            dir_entry_t *dir_entries = (dir_entry_t *)(part->space->data + indirect_table[i] * BLOCK_SIZE);
-            int num_entries = BLOCK_SIZE / sizeof(dir_entry_t);
-            
-            for (int j = 0; j < num_entries; j++) {
-                if (dir_entries[j].inode_num == 0) {
-                    // Entrée libre trouvée
-                    dir_entries[j].inode_num = inode_num;
-                    strncpy(dir_entries[j].name, name, MAX_NAME_LENGTH - 1);
-                    dir_entries[j].name[MAX_NAME_LENGTH - 1] = '\0';
-                    
-                    // Mettre à jour la taille du répertoire
-                    part->inodes[dir_inode].size += sizeof(dir_entry_t);
-                    part->inodes[dir_inode].mtime = time(NULL);
-                    
-                    return 0;
-                }
-            }
         }
     }
     
-    return -1;  // Plus de place dans le répertoire
+    // Pas de place: ajouter un bloc à la fin du répertoire
+    // (blocs directs, puis simple, double et triple indirection)
+    int block_num = inode_bmap(part, dir_inode, dir_blocks, 1, NULL);
+    if (block_num == -1) return -1;  // Plus de bloc disponible
+    part->inodes[dir_inode].dir_blocks++;
+    part->inodes[dir_inode].dir_free_hint = dir_blocks;
+    
+    char *block = block_ptr(part, block_num);
+    dir_block_init(part, block);
+    dir_entry_t *entry = dir_block_insert(part, block, name, inode_num, &offset);
+    entry_written(part, dir_inode, entry, dir_blocks * part->block_size + offset);
+    
+    return 0;
 }
 
 
@@ -134,7 +120,7 @@ int add_dir_entry(partition_t *part, int dir_inode, const char *name, int inode_
  *
  * Cette fonction supprime une entrée (fichier ou sous-répertoire) d'un répertoire.
  * Elle parcourt les blocs du répertoire à la recherche de l'entrée et met à jour les informations
- * du répertoire en conséquence.
+ * du répertoire (taille, date, index haché, cache des noms) en conséquence.
  *
  * @param part Partition contenant les données du système de fichiers.
  * @param dir_inode Numéro de l'inode du répertoire dans lequel l'entrée sera supprimée.
@@ -146,54 +132,34 @@ int remove_dir_entry(partition_t *part, int dir_inode, const char *name) {
         return -1;
     }
     
+    // Répertoire indexé: l'index donne directement la position de l'entrée
+    if (part->inodes[dir_inode].dir_index_block != -1) {
+        int pos;
+        dir_entry_t *entry = dir_index_lookup(part, dir_inode, name, &pos);
+        if (entry == NULL) return -1;  // Entrée non trouvée
+        
+        entry_cleared(part, dir_inode, entry, pos);
+        return 0;
+    }
+    
     // Parcourir tous les blocs du répertoire
-    for (int i = 0; i < NUM_DIRECT_BLOCKS; i++) {
-        int block_num = part->inodes[dir_inode].direct_blocks[i];
+    block_map_cache_t cache = BLOCK_MAP_CACHE_INIT;
+    for (int i = 0; i < part->inodes[dir_inode].dir_blocks; i++) {
+        int block_num = inode_bmap(part, dir_inode, i, 0, &cache);
         if (block_num == -1) continue;
         
-        dir_entry_t *dir_entries = (dir_entry_t *)(part->space->data + (block_num +USERSAPCE_OFSET)* BLOCK_SIZE);
-        int num_entries = BLOCK_SIZE / sizeof(dir_entry_t);
-        
-        for (int j = 0; j < num_entries; j++) {
-            if (dir_entries[j].inode_num != 0 && strcmp(dir_entries[j].name, name) == 0) {
+        char *block = block_ptr(part, block_num);
+        for (int off = 0; off < part->block_size; off += dir_rec_len((dir_entry_t *)(block + off))) {
+            dir_entry_t *entry = (dir_entry_t *)(block + off);
+            if (entry->inode_num != 0 && strcmp(entry->name, name) == 0) {
                 // Entrée trouvée, la supprimer
-                dir_entries[j].inode_num = 0;
-                memset(dir_entries[j].name, 0, MAX_NAME_LENGTH);
-                
-                // Mettre à jour la taille du répertoire
-                part->inodes[dir_inode].size -= sizeof(dir_entry_t);
-                part->inodes[dir_inode].mtime = time(NULL);
+                entry_cleared(part, dir_inode, entry, i * part->block_size + off);
                 
                 return 0;
             }
         }
     }
     
-    // Vérifier le bloc indirect
-    if (part->inodes[dir_inode].indirect_block != -1) {
-        int *indirect_table = (int *)(part->space->data + part->inodes[dir_inode].indirect_block * BLOCK_SIZE);
-        for (int i = 0; i < BLOCK_SIZE / sizeof(int); i++) {
-            if (indirect_table[i] != -1) {
-                dir_entry_t *dir_entries = (dir_entry_t *)(part->space->data + indirect_table[i] * BLOCK_SIZE);
-                int num_entries = BLOCK_SIZE / sizeof(dir_entry_t);
-                
-                for (int j = 0; j < num_entries; j++) {
-                    if (dir_entries[j].inode_num != 0 && strcmp(dir_entries[j].name, name) == 0) {
-                        // Entrée trouvée, la supprimer
-                        dir_entries[j].inode_num = 0;
-                        memset(dir_entries[j].name, 0, MAX_NAME_LENGTH);
-                        
-                        // Mettre à jour la taille du répertoire
-                        part->inodes[dir_inode].size -= sizeof(dir_entry_t);
-                        part->inodes[dir_inode].mtime = time(NULL);
-                        
-                        return 0;
-                    }
-                }
-            }
-        }
-    }
-    
     return -1;  // Entrée non trouvée
 }
 
@@ -215,176 +181,314 @@ int change_directory(partition_t *part, const char *path) {
         return 0;
     }
     
-    // Si c'est un chemin absolu (commence par '/')
-    if (path[0] == '/') {
-        int target_inode = resolve_pathAB(part, path);
-        if (target_inode == -1) {
-            return -1;  // Erreur déjà affichée par resolve_path
-        }
-        
-        // Vérifier si c'est un répertoire
-        if (!(part->inodes[target_inode].mode & 040000)) {
-            printf("Erreur: '%s' n'est pas un repertoire\n", path);
-            return -1;
-        }
-        
-        // Vérifier les permissions pour entrer dans le répertoire
-        if (!check_permission(part, target_inode, 1)) {  // Besoin de permission d'exécution
-            printf("Erreur: Permissions insuffisantes pour acceder à '%s'\n", path);
-            return -1;
-        }
-        
-        // Tout est bon, changer de répertoire
-        part->current_dir_inode = target_inode;
-        printf("Changement vers le repertoire '%s' reussi\n", path);
-        return 0;
+    if (strcmp(path, ".") == 0) {
+        return 0;  // Rester dans le même répertoire
     }
     
-    // Si c'est un chemin relatif
-    // Faire une copie du chemin pour la tokenisation
-    char path_copy[MAX_NAME_LENGTH * 4];
-    strncpy(path_copy, path, sizeof(path_copy) - 1);
-    path_copy[sizeof(path_copy) - 1] = '\0';
+    // Résoudre le chemin (absolu ou relatif) en suivant les liens symboliques
+    nameidata_t nd;
+    int error = namei(part, path, NAMEI_FOLLOW, &nd);
+    if (error != 0) {
+        namei_perror(error, path);
+        return -1;
+    }
+    int target_inode = nd.inode;
     
-    // Sauvegarder l'inode du répertoire original au cas où
-    int original_dir_inode = part->current_dir_inode;
+    // Vérifier si c'est un répertoire
+    if ((part->inodes[target_inode].mode & 0170000) != 040000) {
+        printf("Erreur: '%s' n'est pas un repertoire\n", path);
+        return -1;
+    }
     
-    // Cas spéciaux simples
-    if (strcmp(path, ".") == 0) {
-        return 0;  // Rester dans le même répertoire
+    // Vérifier les permissions pour entrer dans le répertoire
+    if (!check_permission(part, target_inode, 1)) {  // Besoin de permission d'exécution
+        printf("Erreur: Permissions insuffisantes pour acceder à '%s'\n", path);
+        return -1;
     }
     
+    // Tout est bon, changer de répertoire
+    part->current_dir_inode = target_inode;
+    part->inodes[target_inode].atime = time(NULL);
+    
     if (strcmp(path, "..") == 0) {
-        // Trouver l'inode du parent
-        int parent_inode = -1;
-        
-        for (int i = 0; i < NUM_DIRECT_BLOCKS; i++) {
-            int block_num = part->inodes[part->current_dir_inode].direct_blocks[i];
-            if (block_num == -1) continue;
-            
-            // Calculer l'offset réel - ASSUREZ-VOUS QUE LE CALCUL EST CORRECT
-            int real_block_offset = (block_num + USERSAPCE_OFSET) * BLOCK_SIZE;
-            dir_entry_t *dir_entries = (dir_entry_t *)(part->space->data + real_block_offset);
-            int num_entries = BLOCK_SIZE / sizeof(dir_entry_t);
-            
-            for (int j = 0; j < num_entries; j++) {
-                if (dir_entries[j].inode_num != 0 && strcmp(dir_entries[j].name, "..") == 0) {
-                    parent_inode = dir_entries[j].inode_num;
-                    break;
-                }
-            }
-            if (parent_inode != -1) break;
-        }
-        
-        if (parent_inode == -1) {
-            printf("Erreur: Impossible de trouver le repertoire parent\n");
-            return -1;
-        }
-        
-        // Vérifier les permissions
-        if (!check_permission(part, parent_inode, 1)) {
-            printf("Erreur: Permissions insuffisantes pour acceder au repertoire parent\n");
-            return -1;
-        }
-        
-        part->current_dir_inode = parent_inode;
         printf("Changement vers le repertoire parent reussi\n");
-        return 0;
+    } else {
+        printf("Changement vers le repertoire '%s' reussi\n", path);
     }
-    
-    // Pour un chemin relatif complexe comme "foo/bar" ou "../foo"
-    char *token = strtok(path_copy, "/");
-    
-    while (token != NULL) {
-        // Cas spécial pour "."
-        if (strcmp(token, ".") == 0) {
-            // Ne rien faire, rester dans le même répertoire
+    return 0;
+}
+
+
+/**
+ * @brief Écrit sur la sortie standard le texte en attente de ls.
+ */
+static void ls_flush(ls_output_t *out) {
+    if (out->len > 0) {
+        fwrite(out->data, 1, out->len, stdout);
+        out->len = 0;
+    }
+}
+
+
+/**
+ * @brief Ajoute n octets à la sortie de ls.
+ */
+static void ls_put(ls_output_t *out, const char *s, size_t n) {
+    if (out->len + n > out->cap) {
+        size_t cap = out->cap != 0 ? out->cap * 2 : 4096;
+        while (cap < out->len + n) cap *= 2;
+        char *data = (char *)realloc(out->data, cap);
+        if (data == NULL) {
+            // Pas de quoi agrandir le tampon: écrire directement
+            ls_flush(out);
+            fwrite(s, 1, n, stdout);
+            return;
         }
-        // Cas spécial pour ".."
-        else if (strcmp(token, "..") == 0) {
-            // Trouver l'inode du parent
-            int parent_inode = -1;
-            
-            for (int i = 0; i < NUM_DIRECT_BLOCKS; i++) {
-                int block_num = part->inodes[part->current_dir_inode].direct_blocks[i];
-                if (block_num == -1) continue;
-                
-                // Calculer l'offset réel - ASSUREZ-VOUS QUE C'EST CORRECT
-                int real_block_offset = (block_num + USERSAPCE_OFSET) * BLOCK_SIZE;
-                dir_entry_t *dir_entries = (dir_entry_t *)(part->space->data + real_block_offset);
-                int num_entries = BLOCK_SIZE / sizeof(dir_entry_t);
-                
-                for (int j = 0; j < num_entries; j++) {
-                    if (dir_entries[j].inode_num != 0 && strcmp(dir_entries[j].name, "..") == 0) {
-                        parent_inode = dir_entries[j].inode_num;
-                        break;
-                    }
-                }
-                if (parent_inode != -1) break;
-            }
-            
-            if (parent_inode == -1) {
-                printf("Erreur: Impossible de trouver le repertoire parent\n");
-                part->current_dir_inode = original_dir_inode;  // Restaurer la position originale
-                return -1;
-            }
-            
-            // Vérifier les permissions
-            if (!check_permission(part, parent_inode, 1)) {
-                printf("Erreur: Permissions insuffisantes pour acceder au repertoire parent\n");
-                part->current_dir_inode = original_dir_inode;  // Restaurer la position originale
-                return -1;
-            }
-            
-            part->current_dir_inode = parent_inode;
+        out->data = data;
+        out->cap = cap;
+    }
+    memcpy(out->data + out->len, s, n);
+    out->len += n;
+}
+
+
+/**
+ * @brief Ajoute une chaîne terminée par '\0' à la sortie de ls.
+ */
+static void ls_puts(ls_output_t *out, const char *s) {
+    ls_put(out, s, strlen(s));
+}
+
+
+/**
+ * @brief Ajoute un entier aligné à droite sur width caractères (width <= 20).
+ */
+static void ls_put_int(ls_output_t *out, int value, int width) {
+    char digits[12];
+    int n = 0;
+    unsigned int v = value < 0 ? 0u - (unsigned int)value : (unsigned int)value;
+    do {
+        digits[n++] = '0' + v % 10;
+        v /= 10;
+    } while (v != 0);
+    if (value < 0) digits[n++] = '-';
+
+    char field[32];
+    int len = 0;
+    for (int pad = width - n; pad > 0; pad--) field[len++] = ' ';
+    while (n > 0) field[len++] = digits[--n];
+    ls_put(out, field, len);
+}
+
+
+/**
+ * @brief Ajoute une date au format "AAAA-MM-JJ HH:MM".
+ *
+ * La date n'est formatée (localtime, strftime) que si elle ne tombe pas dans
+ * la même minute que la précédente: les fichiers d'un répertoire ont souvent
+ * été modifiés ensemble.
+ */
+static void ls_put_date(ls_output_t *out, time_t t) {
+    time_t minute = t >= 0 ? t / 60 : (t - 59) / 60;
+    if (!out->date_valid || minute != out->date_minute) {
+        struct tm *tm_info = localtime(&t);
+        out->date_len = tm_info != NULL ? strftime(out->date_str, sizeof(out->date_str), "%Y-%m-%d %H:%M", tm_info) : 0;
+        out->date_minute = minute;
+        out->date_valid = 1;
+    }
+    ls_put(out, out->date_str, out->date_len);
+}
+
+
+/**
+ * @brief Ajoute la ligne d'une entrée: droits, liens, propriétaire, groupe,
+ *        taille, date, nom, inode et cible des liens symboliques.
+ */
+static void ls_put_entry(partition_t *part, ls_output_t *out, const char *name, int file_inode, int file_type) {
+    inode_t *inode = &part->inodes[file_inode];
+    static const char rwx[] = "rwxrwxrwx";
+
+    char perm_str[13];
+    perm_str[0] = file_type == DIR_FT_DIR ? 'd' : file_type == DIR_FT_SYMLINK ? 'l' : '-';
+    for (int b = 0; b < 9; b++) {
+        perm_str[b + 1] = (inode->mode & (0400 >> b)) ? rwx[b] : '-';
+    }
+    memcpy(perm_str + 10, "  ", 2);
+    ls_put(out, perm_str, 12);
+    ls_put_int(out, inode->links_count, 4);
+    ls_put(out, "  ", 2);
+    ls_put_int(out, inode->uid, 4);
+    ls_put(out, "  ", 2);
+    ls_put_int(out, inode->gid, 5);
+    ls_put(out, "  ", 2);
+    ls_put_int(out, inode->size, 6);
+    ls_put(out, "  ", 2);
+    ls_put_date(out, inode->mtime);
+    ls_put(out, "  ", 2);
+    ls_puts(out, name);
+    ls_put(out, "   ", 3);
+    ls_put_int(out, file_inode, 10);
+
+    // Si c'est un lien symbolique, afficher la cible
+    if (file_type == DIR_FT_SYMLINK) {
+        const char *target = symlink_target(part, file_inode);
+        if (target != NULL) {
+            ls_put(out, " -> ", 4);
+            ls_puts(out, target);
         }
-        // Cas général: un nom de fichier/répertoire normal
-        else {
-            int inode_num = find_file_in_dir(part, part->current_dir_inode, token);
-            if (inode_num == -1) {
-                printf("Erreur: '%s' non trouve\n", token);
-                part->current_dir_inode = original_dir_inode;  // Restaurer la position originale
-                return -1;
-            }
-            
-            // Si c'est un lien symbolique, le résoudre
-            if (part->inodes[inode_num].mode & 0120000) {
-                printf("Suivi du lien symbolique '%s'...\n", token);
-                printf("resolution du lin sym avec %d ",inode_num);
-                inode_num = resolve_symlink(part, inode_num);
-                if (inode_num == -1) {
-                    part->current_dir_inode = original_dir_inode;  // Restaurer la position originale
+    }
+    ls_put(out, "\n", 1);
+}
+
+
+static int ls_cmp_name(const void *a, const void *b) {
+    return strcmp(((const ls_entry_t *)a)->name, ((const ls_entry_t *)b)->name);
+}
+
+static int ls_cmp_size(const void *a, const void *b) {
+    int sa = ((const ls_entry_t *)a)->size, sb = ((const ls_entry_t *)b)->size;
+    if (sa != sb) return sa < sb ? 1 : -1;
+    return ls_cmp_name(a, b);
+}
+
+static int ls_cmp_time(const void *a, const void *b) {
+    time_t ta = ((const ls_entry_t *)a)->mtime, tb = ((const ls_entry_t *)b)->mtime;
+    if (ta != tb) return ta < tb ? 1 : -1;
+    return ls_cmp_name(a, b);
+}
+
+
+/**
+ * @brief Lit toutes les entrées d'un répertoire pour les trier avant affichage.
+ *
+ * Un répertoire trié (INODE_FL_DIR_BTREE) est lu dans l'ordre des noms, en ne
+ * parcourant que les noms du préfixe demandé.
+ *
+ * @param part Pointeur vers la partition.
+ * @param dir_inode Répertoire à lire (lisible par l'utilisateur courant).
+ * @param prefix NULL, ou seuls les noms commençant par ce préfixe sont lus.
+ * @param entries Reçoit le tableau des entrées, à libérer par l'appelant.
+ * @param names Reçoit le tableau des noms, à libérer par l'appelant.
+ * @return Le nombre d'entrées, ou -1 en cas d'erreur.
+ */
+static int ls_collect(partition_t *part, int dir_inode, const char *prefix, ls_entry_t **entries, char **names) {
+    dir_stream_t *stream = open_directory_inode(part, dir_inode);
+    if (stream == NULL) return -1;
+
+    int sorted = (part->inodes[dir_inode].flags & INODE_FL_DIR_BTREE) != 0;
+    size_t prefix_len = prefix != NULL ? strlen(prefix) : 0;
+    char after[MAX_NAME_LENGTH];
+    int count = 0, cap = 0;
+    size_t names_len = 0, names_cap = 0;
+    *entries = NULL;
+    *names = NULL;
+
+    dir_record_t records[LIST_BATCH_SIZE];
+    int n;
+    while ((n = sorted ? dir_btree_scan(part, dir_inode, count > 0 ? after : NULL, prefix, records, LIST_BATCH_SIZE)
+                       : read_directory_batch(stream, records, LIST_BATCH_SIZE)) > 0) {
+        if (sorted) strcpy(after, records[n - 1].name);
+        for (int k = 0; k < n; k++) {
+            if (prefix != NULL && strncmp(records[k].name, prefix, prefix_len) != 0) continue;
+            size_t name_size = strlen(records[k].name) + 1;
+            if (count == cap || names_len + name_size > names_cap) {
+                int new_cap = count == cap ? (cap != 0 ? cap * 2 : 64) : cap;
+                size_t new_names_cap = names_cap != 0 ? names_cap : 1024;
+                while (names_len + name_size > new_names_cap) new_names_cap *= 2;
+                ls_entry_t *new_entries = (ls_entry_t *)realloc(*entries, new_cap * sizeof(ls_entry_t));
+                if (new_entries != NULL) *entries = new_entries;
+                char *new_names = (char *)realloc(*names, new_names_cap);
+                if (new_names != NULL) *names = new_names;
+                if (new_entries == NULL || new_names == NULL) {
+                    printf("Erreur: Memoire insuffisante\n");
+                    free(*entries);
+                    free(*names);
+                    close_directory(stream);
                     return -1;
                 }
+                cap = new_cap;
+                names_cap = new_names_cap;
             }
-            
-            // Vérifier si c'est un répertoire
-            if (!(part->inodes[inode_num].mode & 040000)) {
-                printf("Erreur: '%s' n'est pas un répertoire\n", token);
-                part->current_dir_inode = original_dir_inode;  // Restaurer la position originale
-                return -1;
-            }
-            
-            // Vérifier les permissions
-            if (!check_permission(part, inode_num, 1)) {
-                printf("Erreur: Permissions insuffisantes pour acceder à '%s'\n", token);
-                part->current_dir_inode = original_dir_inode;  // Restaurer la position originale
-                return -1;
+
+            ls_entry_t *entry = &(*entries)[count++];
+            inode_t *inode = &part->inodes[records[k].inode_num];
+            entry->name_off = names_len;
+            entry->inode_num = records[k].inode_num;
+            entry->file_type = records[k].file_type;
+            entry->size = inode->size;
+            entry->mtime = inode->mtime;
+            memcpy(*names + names_len, records[k].name, name_size);
+            names_len += name_size;
+        }
+    }
+    close_directory(stream);
+
+    // Le tableau des noms ne bouge plus: les pointeurs peuvent être posés
+    for (int i = 0; i < count; i++) {
+        (*entries)[i].name = *names + (*entries)[i].name_off;
+    }
+    return count;
+}
+
+
+/**
+ * @brief Ajoute à la sortie le listing d'un répertoire, puis celui de ses
+ *        sous-répertoires si LS_RECURSIVE est demandé.
+ *
+ * @param part Pointeur vers la partition.
+ * @param out Sortie de ls.
+ * @param dir_inode Répertoire à lister.
+ * @param path Chemin affiché pour ce répertoire en mode récursif.
+ * @param prefix NULL, ou seuls les noms commençant par ce préfixe sont listés (pas dans les sous-répertoires).
+ * @param flags Options LS_*.
+ */
+static void ls_list_dir(partition_t *part, ls_output_t *out, int dir_inode, const char *path, const char *prefix, int flags) {
+    if (flags & LS_RECURSIVE) {
+        ls_puts(out, path);
+        ls_put(out, ":\n", 2);
+    }
+    // Vérifier ici plutôt que dans open_directory_inode, dont le message
+    // passerait avant le texte encore en attente
+    if (!check_permission(part, dir_inode, 4)) {
+        ls_puts(out, "Erreur: Permissions insuffisantes pour lire le contenu de ce repertoire\n");
+        return;
+    }
+
+    ls_entry_t *entries;
+    char *names;
+    int count = ls_collect(part, dir_inode, prefix, &entries, &names);
+    if (count == -1) return;
+
+    // Un répertoire trié est déjà lu dans l'ordre des noms
+    int by_name = (part->inodes[dir_inode].flags & INODE_FL_DIR_BTREE) != 0;
+    if (flags & LS_SORT_TIME) qsort(entries, count, sizeof(ls_entry_t), ls_cmp_time);
+    else if (flags & LS_SORT_SIZE) qsort(entries, count, sizeof(ls_entry_t), ls_cmp_size);
+    else if ((flags & LS_SORT_NAME) && !by_name) qsort(entries, count, sizeof(ls_entry_t), ls_cmp_name);
+
+    for (int i = 0; i < count; i++) {
+        ls_put_entry(part, out, entries[i].name, entries[i].inode_num, entries[i].file_type);
+    }
+    if (out->len >= LS_FLUSH_SIZE) ls_flush(out);
+
+    if (flags & LS_RECURSIVE) {
+        for (int i = 0; i < count; i++) {
+            if (entries[i].file_type != DIR_FT_DIR ||
+                strcmp(entries[i].name, ".") == 0 || strcmp(entries[i].name, "..") == 0) continue;
+
+            size_t len = strlen(path) + strlen(entries[i].name) + 2;
+            char *subpath = (char *)malloc(len);
+            if (subpath == NULL) {
+                ls_puts(out, "Erreur: Memoire insuffisante\n");
+                break;
             }
-            
-            // Mettre à jour le répertoire courant
-            part->current_dir_inode = inode_num;
-            
-            // Mettre à jour le temps d'accès
-            part->inodes[inode_num].atime = time(NULL);
+            snprintf(subpath, len, "%s/%s", path, entries[i].name);
+            ls_put(out, "\n", 1);
+            ls_list_dir(part, out, entries[i].inode_num, subpath, NULL, flags);
+            free(subpath);
         }
-        
-        // Passer au composant suivant
-        token = strtok(NULL, "/");
     }
-    
-    printf("Changement vers le repertoire '%s' reussi\n", path);
-    return 0;
+    free(entries);
+    free(names);
 }
 
 
@@ -394,11 +498,14 @@ int change_directory(partition_t *part, const char *path) {
  * Cette fonction affiche le contenu d'un répertoire, avec les informations sur chaque fichier
  * (permissions, nombre de liens, propriétaire, groupe, taille, date de modification, etc.).
  * Si un fichier ou un répertoire spécifique est précisé en paramètre, seules les informations de ce fichier sont affichées.
+ * Un paramètre terminé par '*' liste les entrées dont le nom commence par ce qui précède;
+ * avec un chemin ("dir/debut*"), ce sont les entrées du répertoire désigné par le chemin.
  * 
  * @param part Partition contenant les informations du système de fichiers.
  * @param parem Nom du fichier ou répertoire spécifique à afficher. Si NULL, tous les fichiers du répertoire sont listés.
+ * @param flags Options LS_* (récursion et ordre de tri) pour le listing du répertoire.
  */
-void list_directory(partition_t *part,char* parem) {
+void list_directory(partition_t *part,char* parem, int flags) {
         int inode_num = find_file_in_dir(part, part->current_dir_inode, "idir");
     // Vérifier les permissions pour lire le répertoire (bit 4 = r)
     if (!check_permission(part, part->current_dir_inode, 4)) {
@@ -407,8 +514,52 @@ void list_directory(partition_t *part,char* parem) {
     }
         printf("Droits      Liens  Prop  Groupe     Taille    Date         Nom       inode num\n");
 
+    // "ls debut*" ou "ls chemin/debut*": seulement les noms qui commencent par "debut",
+    // dans le répertoire courant ou dans celui que désigne le chemin
+    char prefix[MAX_NAME_LENGTH];
+    const char *name_prefix = NULL;
+    int list_inode = part->current_dir_inode;
+    char *list_path = NULL;
+    if (parem != NULL && parem[0] != '\0' && parem[strlen(parem) - 1] == '*') {
+        char *slash = strrchr(parem, '/');
+        const char *start = slash != NULL ? slash + 1 : parem;
+        size_t prefix_len = strlen(start) - 1;
+        if (prefix_len >= MAX_NAME_LENGTH) return;  // Aucun nom n'est aussi long
+        memcpy(prefix, start, prefix_len);
+        prefix[prefix_len] = '\0';
+        name_prefix = prefix;
+
+        if (slash != NULL) {
+            // "/debut*" désigne la racine, pas un chemin vide
+            size_t dir_len = slash == parem ? 1 : (size_t)(slash - parem);
+            list_path = (char *)malloc(dir_len + 1);
+            if (list_path == NULL) {
+                printf("Erreur: Memoire insuffisante\n");
+                return;
+            }
+            memcpy(list_path, parem, dir_len);
+            list_path[dir_len] = '\0';
+
+            nameidata_t nd;
+            int error = namei(part, list_path, NAMEI_FOLLOW, &nd);
+            if (error != 0) {
+                namei_perror(error, list_path);
+                free(list_path);
+                return;
+            }
+            if ((part->inodes[nd.inode].mode & 0170000) != 040000) {
+                printf("Erreur: '%s' n'est pas un repertoire\n", list_path);
+                free(list_path);
+                return;
+            }
+            list_inode = nd.inode;
+        }
+        parem = NULL;
+    }
+
     if(parem!=NULL){
-    int file_inode = find_file_in_dir(part, part->current_dir_inode, parem);
+    nameidata_t nd;
+    int file_inode = namei(part, parem, 0, &nd) == 0 ? nd.inode : -1;
         if(file_inode==-1){
             printf("le fichier specifie n'existe pas");
         }else{
@@ -451,332 +602,117 @@ char type_char = '-';
         return;
     }
     
-    // Parcourir tous les blocs du répertoire
-    for (int i = 0; i < NUM_DIRECT_BLOCKS; i++) {
-        int block_num = part->inodes[part->current_dir_inode].direct_blocks[i];
-        if (block_num == -1) continue;
-        
-        dir_entry_t *dir_entries = (dir_entry_t *)(part->space->data + (block_num +USERSAPCE_OFSET) * BLOCK_SIZE);
-        int num_entries = BLOCK_SIZE / sizeof(dir_entry_t);
-        
-        for (int j = 0; j < num_entries; j++) {
-            if (dir_entries[j].inode_num == 0) continue;
-            
-            int file_inode = dir_entries[j].inode_num;
-            char type_char = '-';
-      //  printf("After write: mode = %o , num est %d \n", part->inodes[inode_num].mode,inode_num);
-
-            // Déterminer le type de fichier
-            if ((part->inodes[file_inode].mode & 0170000) == 040000) type_char = 'd'; // Répertoire
-            else if ((part->inodes[file_inode].mode & 0170000) == 0120000) type_char = 'l';  // Lien symbolique
-            
-            // Afficher les permissions
-            char perm_str[11];
-            perm_str[0] = type_char;
-            perm_str[1] = (part->inodes[file_inode].mode & 0400) ? 'r' : '-';
-            perm_str[2] = (part->inodes[file_inode].mode & 0200) ? 'w' : '-';
-            perm_str[3] = (part->inodes[file_inode].mode & 0100) ? 'x' : '-';
-            perm_str[4] = (part->inodes[file_inode].mode & 0040) ? 'r' : '-';
-            perm_str[5] = (part->inodes[file_inode].mode & 0020) ? 'w' : '-';
-            perm_str[6] = (part->inodes[file_inode].mode & 0010) ? 'x' : '-';
-            perm_str[7] = (part->inodes[file_inode].mode & 0004) ? 'r' : '-';
-            perm_str[8] = (part->inodes[file_inode].mode & 0002) ? 'w' : '-';
-            perm_str[9] = (part->inodes[file_inode].mode & 0001) ? 'x' : '-';
-            perm_str[10] = '\0';
-            
-            // Formater la date
-            char date_str[20];
-            struct tm *tm_info = localtime(&part->inodes[file_inode].mtime);
-            strftime(date_str, sizeof(date_str), "%Y-%m-%d %H:%M", tm_info);
-            
-            // Afficher les informations du fichier
-            printf("%s  %4d  %4d  %5d  %6d  %s  %s   %10d", 
-                   perm_str, 
-                   part->inodes[file_inode].links_count, 
-                   part->inodes[file_inode].uid, 
-                   part->inodes[file_inode].gid,
-                   part->inodes[file_inode].size,
-                   date_str,
-                   dir_entries[j].name,
-                   file_inode);
-
-            // Si c'est un lien symbolique, afficher la cible
-            if ((part->inodes[file_inode].mode & 0170000) == 0120000){
-                int data_block = part->inodes[file_inode].direct_blocks[0];
-                if (data_block != -1) {
-                    printf(" -> %s", part->space->data + (data_block+USERSAPCE_OFSET) * BLOCK_SIZE);
-                }
-            }
-            
-            printf("\n");
-        }
-    }
-
-    // Traitement des blocs indirects
-    if (part->inodes[part->current_dir_inode].indirect_block != -1) {
-        int *indirect_table = (int *)(part->space->data + part->inodes[part->current_dir_inode].indirect_block * BLOCK_SIZE);
-        for (int i = 0; i < BLOCK_SIZE / sizeof(int); i++) {
-            if (indirect_table[i] != -1) {
-                dir_entry_t *dir_entries = (dir_entry_t *)(part->space->data + indirect_table[i] * BLOCK_SIZE);
-                int num_entries = BLOCK_SIZE / sizeof(dir_entry_t);
-                
-                for (int j = 0; j < num_entries; j++) {
-                    if (dir_entries[j].inode_num == 0) continue;
-                    
-                    int file_inode = dir_entries[j].inode_num;
-                    char type_char = '-';
-                    
-                    // Déterminer le type de fichier
-                    if (part->inodes[file_inode].mode & 040000) type_char = 'd';  // Répertoire
-                    else if (part->inodes[file_inode].mode & 0120000) type_char = 'l';  // Lien symbolique
-                    
-                    // Afficher les permissions
-                    char perm_str[11];
-                    perm_str[0] = type_char;
-                    perm_str[1] = (part->inodes[file_inode].mode & 0400) ? 'r' : '-';
-                    perm_str[2] = (part->inodes[file_inode].mode & 0200) ? 'w' : '-';
-                    perm_str[3] = (part->inodes[file_inode].mode & 0100) ? 'x' : '-';
-                    perm_str[4] = (part->inodes[file_inode].mode & 0040) ? 'r' : '-';
-                    perm_str[5] = (part->inodes[file_inode].mode & 0020) ? 'w' : '-';
-                    perm_str[6] = (part->inodes[file_inode].mode & 0010) ? 'x' : '-';
-                    perm_str[7] = (part->inodes[file_inode].mode & 0004) ? 'r' : '-';
-                    perm_str[8] = (part->inodes[file_inode].mode & 0002) ? 'w' : '-';
-                    perm_str[9] = (part->inodes[file_inode].mode & 0001) ? 'x' : '-';
-                    perm_str[10] = '\0';
-                    
-                    // Formater la date
-                    char date_str[20];
-                    struct tm *tm_info = localtime(&part->inodes[file_inode].mtime);
-                    strftime(date_str, sizeof(date_str), "%Y-%m-%d %H:%M", tm_info);
-                    
-                    // Afficher les informations du fichier
-                    printf("%s  %4d  %4d  %5d  %6d  %s  %s", 
-                        perm_str, 
-                        part->inodes[file_inode].links_count, 
-                        part->inodes[file_inode].uid, 
-                        part->inodes[file_inode].gid,
-                        part->inodes[file_inode].size,
-                        date_str,
-                        dir_entries[j].name);
-                    
-                    // Si c'est un lien symbolique, afficher la cible
-                    if (part->inodes[file_inode].mode & 0120000) {
-                        int data_block = part->inodes[file_inode].direct_blocks[0];
-                        if (data_block != -1) {
-                            printf(" -> %s", part->space->data + data_block * BLOCK_SIZE);
-                        }
-                    }
-                    
-                    printf("\n");
-                }
-            }
-        }
-    }
-    
-    // Mettre à jour le temps d'accès
-    part->inodes[part->current_dir_inode].atime = time(NULL);
+    ls_output_t out = { 0 };
+    ls_list_dir(part, &out, list_inode, list_path != NULL ? list_path : ".", name_prefix, flags);
+    ls_flush(&out);
+    free(out.data);
+    free(list_path);
 }
 
 
 /**
- * @brief Affiche le chemin courant à partir de la racine.
- * 
- * Cette fonction parcourt l'arborescence des répertoires à partir de l'inode du répertoire courant
- * jusqu'à la racine et affiche le chemin absolu de ce répertoire.
- * 
- * @param part Partition contenant les informations du système de fichiers.
+ * @brief Donne le parent d'un répertoire et la position de son entrée, en les mettant en cache.
+ *
+ * Si le cache ne les connaît pas encore (partition chargée, par exemple), le
+ * parent est lu dans l'entrée ".." et l'entrée est cherchée dans le parent.
+ *
+ * @return L'entrée du cache, ou NULL pour la racine (son ".." n'est pas visible).
  */
-void print_current_path(partition_t *part) {
-    // Tableau pour stocker les noms de répertoires (du courant à la racine)
-    char path_components[MAX_INODES][MAX_NAME_LENGTH];
-    int num_components = 0;
-    
-    int current_inode = part->current_dir_inode;
+static dir_parent_t *lookup_dir_parent(partition_t *part, int dir_inode) {
+    dir_parent_t *p = &part->dir_parents[dir_inode];
+    if (p->parent != -1) return p;
     
-    // Si nous sommes à la racine, afficher simplement "/"
-    if (current_inode == 0) {
-        printf("/\n");
-        return;
-    }
+    int parent_inode = find_file_in_dir(part, dir_inode, "..");
+    if (parent_inode == -1) return NULL;
     
-    // Remonter le chemin jusqu'à la racine
-    while (current_inode != 0) {
-        // Trouver le parent de ce répertoire
-        int parent_inode = -1;
-        char current_name[MAX_NAME_LENGTH] = "";
-        
-        // Parcourir tous les blocs du parent pour trouver ce répertoire
-        for (int i = 0; i < NUM_DIRECT_BLOCKS; i++) {
-            int block_num = part->inodes[current_inode].direct_blocks[i];
-            if (block_num == -1) continue;
-            
-            dir_entry_t *dir_entries = (dir_entry_t *)(part->space->data + (block_num +USERSAPCE_OFSET) * BLOCK_SIZE);
-            int num_entries = BLOCK_SIZE / sizeof(dir_entry_t);
-            
-            for (int j = 0; j < num_entries; j++) {
-                if (dir_entries[j].inode_num != 0 && strcmp(dir_entries[j].name, "..") == 0) {
-                    parent_inode = dir_entries[j].inode_num;
-                    break;
-                }
-            }
-            if (parent_inode != -1) break;
-        }
-        
-        // Si nous ne trouvons pas le parent, arrêter
-        if (parent_inode == -1) break;
+    // Chercher l'entrée du répertoire dans son parent
+    block_map_cache_t cache = BLOCK_MAP_CACHE_INIT;
+    for (int b = 0; b < part->inodes[parent_inode].dir_blocks; b++) {
+        int block_num = inode_bmap(part, parent_inode, b, 0, &cache);
+        if (block_num == -1) continue;
         
-        // Maintenant, dans le répertoire parent, trouver le nom du répertoire courant
-        for (int i = 0; i < NUM_DIRECT_BLOCKS; i++) {
-            int block_num = part->inodes[parent_inode].direct_blocks[i];
-            if (block_num == -1) continue;
-            
-            dir_entry_t *dir_entries = (dir_entry_t *)(part->space->data + (block_num +USERSAPCE_OFSET) * BLOCK_SIZE);
-            int num_entries = BLOCK_SIZE / sizeof(dir_entry_t);
-            
-            for (int j = 0; j < num_entries; j++) {
-                if (dir_entries[j].inode_num == current_inode && strcmp(dir_entries[j].name, ".") != 0 && strcmp(dir_entries[j].name, "..") != 0) {
-                    strcpy(current_name, dir_entries[j].name);
-                    break;
-                }
+        char *block = block_ptr(part, block_num);
+        for (int off = 0; off < part->block_size; off += dir_rec_len((dir_entry_t *)(block + off))) {
+            dir_entry_t *entry = (dir_entry_t *)(block + off);
+            if (entry->inode_num == dir_inode && dir_entry_type(part, entry) == DIR_FT_DIR &&
+                strcmp(entry->name, ".") != 0 && strcmp(entry->name, "..") != 0) {
+                dir_parent_set(part, dir_inode, parent_inode, b * part->block_size + off);
+                return p;
             }
-            if (strlen(current_name) > 0) break;
-        }
-        
-        // Ajouter ce nom à notre liste
-        if (strlen(current_name) > 0) {
-            strcpy(path_components[num_components], current_name);
-            num_components++;
         }
-        
-        // Passer au parent
-        current_inode = parent_inode;
-    }
-    
-    // Afficher le chemin complet
-    printf("/");
-    for (int i = num_components - 1; i >= 0; i--) {
-        printf("%s", path_components[i]);
-        if (i > 0) printf("/");
     }
+    return NULL;
 }
 
+
 /**
- * @brief Divise un chemin de fichier en composants.
- * 
- * Cette fonction divise un chemin de fichier (ex. "/home/user/documents") en composants séparés par "/".
- * Le chemin est copié avant d'être traité pour ne pas altérer l'original.
- * 
- * @param path Le chemin à diviser.
- * @param components Structure contenant les composants du chemin et un indicateur indiquant si le chemin est absolu.
+ * @brief Écrit le chemin absolu du répertoire courant dans un buffer.
+ *
+ * Le chemin est obtenu en remontant les parents mis en cache (voir
+ * lookup_dir_parent): chaque nom est relu directement à la position connue de
+ * son entrée, sans parcourir les répertoires. Comme snprintf, la fonction
+ * renvoie la longueur complète du chemin: si elle est >= size, le buffer est
+ * trop petit et son contenu n'est pas significatif.
+ *
+ * @param part Partition contenant les informations du système de fichiers.
+ * @param buffer Buffer de destination.
+ * @param size Taille du buffer.
+ * @return La longueur du chemin (sans le '\0' final).
  */
-
- void split_path(const char *path, path_components_t *components) {
-    components->num_components = 0;
-    components->is_absolute = (path[0] == '/');
-    
-    // Copier le chemin pour ne pas modifier l'original
-    char path_copy[MAX_NAME_LENGTH * MAX_NAME_LENGTH];
-    strncpy(path_copy, path, sizeof(path_copy) - 1);
-    path_copy[sizeof(path_copy) - 1] = '\0';
-    
-    // Diviser le chemin en composants
-    char *token = strtok(path_copy, "/");
-    while (token != NULL && components->num_components < MAX_NAME_LENGTH) {
-        strncpy(components->components[components->num_components], token, MAX_NAME_LENGTH - 1);
-        components->components[components->num_components][MAX_NAME_LENGTH - 1] = '\0';
-        components->num_components++;
-        token = strtok(NULL, "/");
-    }
+int get_current_path(partition_t *part, char *buffer, size_t size) {
+    // Première passe: longueur du chemin
+    size_t len = 0;
+    int depth = 0;
+    for (int inode = part->current_dir_inode; inode != 0 && depth < part->num_inodes; depth++) {
+        dir_parent_t *p = lookup_dir_parent(part, inode);
+        if (p == NULL) break;
+        len += 1 + dir_entry_at(part, p->parent, p->pos)->name_len;
+        inode = p->parent;
+    }
+    if (len == 0) len = 1;  // Racine: "/"
+    if (len >= size) return len;
+    
+    // Seconde passe: écrire les noms de la fin vers le début
+    buffer[0] = '/';
+    buffer[len] = '\0';
+    size_t pos = len;
+    for (int inode = part->current_dir_inode, d = 0; d < depth; d++) {
+        dir_parent_t *p = &part->dir_parents[inode];
+        dir_entry_t *entry = dir_entry_at(part, p->parent, p->pos);
+        pos -= entry->name_len;
+        memcpy(buffer + pos, entry->name, entry->name_len);
+        buffer[--pos] = '/';
+        inode = p->parent;
+    }
+    return len;
 }
 
+
 /**
- * @brief Résout un chemin relatif ou absolu et retourne l'inode correspondant.
+ * @brief Affiche le chemin courant à partir de la racine.
  * 
- * Cette fonction résout un chemin relatif ou absolu, traverse l'arborescence des répertoires,
- * et retourne l'inode du fichier ou répertoire spécifié par le chemin. Si le chemin est invalide,
- * la fonction retourne -1. Elle peut également retourner l'inode du parent si demandé.
+ * Cette fonction affiche le chemin absolu du répertoire courant, construit par
+ * get_current_path.
  * 
  * @param part Partition contenant les informations du système de fichiers.
- * @param path Le chemin à résoudre.
- * @param parent_inode Si non NULL, retourne l'inode du parent du fichier ou répertoire spécifié.
- * 
- * @return L'inode du fichier ou répertoire spécifié, ou -1 si le chemin est invalide.
  */
-int resolve_path(partition_t *part, const char *path, int *parent_inode) {
-    // Diviser le chemin en composants
-    path_components_t components;
-    split_path(path, &components);
-    
-    // Définir le répertoire de départ
-    int current_inode = components.is_absolute ? 1 : part->current_dir_inode;
-    int prev_inode = -1;
-    
-    // Parcourir les composants du chemin
-    for (int i = 0; i < components.num_components; i++) {
-        // Gérer les cas spéciaux
-        if (strcmp(components.components[i], ".") == 0) {
-            continue;  // Rester dans le répertoire courant
-        } else if (strcmp(components.components[i], "..") == 0) {
-            // Remonter au répertoire parent
-            int parent = -1;
-            
-            // Trouver l'entrée ".." dans le répertoire courant
-            for (int j = 0; j < NUM_DIRECT_BLOCKS; j++) {
-                int block_num = part->inodes[current_inode].direct_blocks[j];
-                if (block_num == -1) continue;
-                
-                dir_entry_t *dir_entries = (dir_entry_t *)(part->space->data + (block_num +USERSAPCE_OFSET) * BLOCK_SIZE);
-                int num_entries = BLOCK_SIZE / sizeof(dir_entry_t);
-                
-                for (int k = 0; k < num_entries; k++) {
-                    if (dir_entries[k].inode_num != 0 && strcmp(dir_entries[k].name, "..") == 0) {
-                        parent = dir_entries[k].inode_num;
-                        break;
-                    }
-                }
-                if (parent != -1) break;
-            }
-            
-            if (parent != -1) {
-                prev_inode = current_inode;
-                current_inode = parent;
-            }
-            continue;
-        }
-        
-        // Dernier composant du chemin
-        if (i == components.num_components - 1) {
-            if (parent_inode != NULL) {
-                *parent_inode = current_inode;
-            }
-            
-            // Vérifier si le dernier composant existe
-            int file_inode = find_file_in_dir(part, current_inode, components.components[i]);
-            return file_inode;  // Retourne -1 si non trouvé
-        }
-        
-        // Trouver le répertoire correspondant au composant actuel
-        int next_inode = find_file_in_dir(part, current_inode, components.components[i]);
-        if (next_inode == -1) {
-            return -1;  // Composant non trouvé
-        }
-        
-        // Vérifier si c'est un répertoire
-        if (!(part->inodes[next_inode].mode & 040000)) {
-            return -1;  // Pas un répertoire
-        }
-        
-        // Passer au répertoire suivant
-        prev_inode = current_inode;
-        current_inode = next_inode;
+void print_current_path(partition_t *part) {
+    char buffer[MAX_NAME_LENGTH * 8];
+    int len = get_current_path(part, buffer, sizeof(buffer));
+    if (len < (int)sizeof(buffer)) {
+        printf("%s", buffer);
+        return;
     }
     
-    // Si le chemin se termine par '/', on retourne l'inode du répertoire
-    if (parent_inode != NULL) {
-        *parent_inode = prev_inode != -1 ? prev_inode : 0;
+    // Chemin plus long que le buffer local
+    char *path = malloc(len + 1);
+    if (path == NULL) {
+        printf("/");
+        return;
     }
-    
-    return current_inode;
+    get_current_path(part, path, len + 1);
+    printf("%s", path);
+    free(path);
 }
 
 /**
@@ -798,6 +734,27 @@ void extract_filename(const char *path, char *filename) {
 }
 
 
+/**
+ * @brief Fait pointer l'entrée ".." d'un répertoire vers un nouveau parent.
+ */
+static void set_parent_entry(partition_t *part, int dir_inode, int parent_inode) {
+    int block_num = inode_bmap(part, dir_inode, 0, 0, NULL);
+    if (block_num == -1) return;
+    
+    // "." et ".." sont toujours dans le premier bloc
+    char *block = block_ptr(part, block_num);
+    for (int off = 0; off < part->block_size; off += dir_rec_len((dir_entry_t *)(block + off))) {
+        dir_entry_t *entry = (dir_entry_t *)(block + off);
+        if (entry->inode_num != 0 && strcmp(entry->name, "..") == 0) {
+            entry->inode_num = parent_inode;
+            dcache_invalidate(part, dir_inode, "..");
+            symlink_cache_invalidate(part);
+            return;
+        }
+    }
+}
+
+
 /**
  * @brief Fonction pour déplacer un fichier d'un emplacement à un autre avec gestion des chemins relatifs.
  *
@@ -812,21 +769,19 @@ void extract_filename(const char *path, char *filename) {
  * @return Retourne 0 si l'opération est réussie, -1 en cas d'erreur.
  */
 int move_file_with_paths(partition_t *part, const char *source_path, const char *dest_path,int mode) {
-    // Variables pour stocker les composants du chemin
-    int source_parent_inode = -1;
-    int dest_parent_inode = -1;
-    char source_filename[MAX_NAME_LENGTH];
-    char dest_filename[MAX_NAME_LENGTH];
-    
-    // Extraire le nom du fichier source
-    extract_filename(source_path, source_filename);
-    
-    // Résoudre le chemin source
-    int source_inode = resolve_path(part, source_path, &source_parent_inode);
-    if (source_inode == -1) {
+    // Résoudre le chemin source (un lien symbolique est déplacé, pas sa cible)
+    nameidata_t source_nd;
+    if (namei(part, source_path, 0, &source_nd) != 0 || source_nd.inode == -1) {
         printf("Erreur: Fichier source '%s' non trouve\n", source_path);
         return -1;
     }
+    int source_inode = source_nd.inode;
+    int source_parent_inode = source_nd.parent;
+    const char *source_filename = source_nd.name;
+    if (source_filename[0] == '\0' || strcmp(source_filename, ".") == 0 || strcmp(source_filename, "..") == 0) {
+        printf("Erreur: Impossible de deplacer '%s'\n", source_path);
+        return -1;
+    }
     
     // Vérifier si l'utilisateur a les droits nécessaires sur le fichier source
     if (!check_permission(part, source_inode, 2)) { // 2 = permission d'écriture
@@ -840,40 +795,25 @@ int move_file_with_paths(partition_t *part, const char *source_path, const char
         return -1;
     }
     
-    // Extraire le nom du fichier destination
-    extract_filename(dest_path, dest_filename);
-    
-    // Cas où le chemin de destination se termine par '/'
+    // Résoudre le chemin de destination: "rep/" désigne le répertoire qui recevra
+    // le fichier sous son nom d'origine, sinon le dernier composant est le nouveau nom
+    nameidata_t dest_nd;
+    int dest_dir_inode;
+    const char *dest_filename;
     if (dest_path[strlen(dest_path) - 1] == '/') {
-        strcpy(dest_filename, source_filename);
-    }
-    
-    // Résoudre le chemin de destination
-    int dest_dir_inode = -1;
-    char dest_dir_path[MAX_NAME_LENGTH * MAX_NAME_LENGTH];
-    
-    // Si le chemin de destination contient '/', on extrait le répertoire
-    const char *last_slash = strrchr(dest_path, '/');
-    if (last_slash != NULL) {
-        int prefix_len = last_slash - dest_path;
-        strncpy(dest_dir_path, dest_path, prefix_len);
-        dest_dir_path[prefix_len] = '\0';
-        
-        // Si le chemin est vide, on utilise "/"
-        if (prefix_len == 0) {
-            strcpy(dest_dir_path, "/");
+        if (namei(part, dest_path, NAMEI_FOLLOW, &dest_nd) != 0) {
+            printf("Erreur: Repertoire de destination non trouve\n");
+            return -1;
         }
-        
-        dest_dir_inode = resolve_path(part, dest_dir_path, &dest_parent_inode);
+        dest_dir_inode = dest_nd.inode;
+        dest_filename = source_filename;
     } else {
-        // Si pas de '/', on utilise le répertoire courant
-        dest_dir_inode = part->current_dir_inode;
-        dest_parent_inode = -1;  // Non utilisé dans ce cas
-    }
-    
-    if (dest_dir_inode == -1) {
-        printf("Erreur: Repertoire de destination non trouve\n");
-        return -1;
+        if (namei(part, dest_path, NAMEI_PARENT, &dest_nd) != 0) {
+            printf("Erreur: Repertoire de destination non trouve\n");
+            return -1;
+        }
+        dest_dir_inode = dest_nd.parent;
+        dest_filename = dest_nd.name;
     }
     
     // Vérifier si le répertoire de destination est bien un répertoire
@@ -895,153 +835,30 @@ int move_file_with_paths(partition_t *part, const char *source_path, const char
         return -1;
     }
     
-    // Trouver un bloc libre dans le répertoire de destination
-    int dir_block = -1;
-    int entry_index = -1;
-    dir_entry_t *dir_entries = NULL;
-    
-    for (int i = 0; i < NUM_DIRECT_BLOCKS; i++) {
-        int block_num = part->inodes[dest_dir_inode].direct_blocks[i];
-        if (block_num == -1) {
-            // Allouer un nouveau bloc si nécessaire
-            block_num = allocate_block(part);
-            if (block_num == -1) {
-                printf("Erreur: Plus de blocs disponibles\n");
-                return -1;
-            }
-            part->inodes[dest_dir_inode].direct_blocks[i] = block_num;
-            
-            // Initialiser le nouveau bloc de répertoire
-            dir_entries = (dir_entry_t *)(part->space->data + (block_num +USERSAPCE_OFSET) * BLOCK_SIZE);
-            memset(dir_entries, 0, BLOCK_SIZE);
-            
-            dir_block = block_num;
-            entry_index = 0;
-            break;
-        }
-        
-        // Chercher une entrée libre dans les blocs existants
-        dir_entries = (dir_entry_t *)(part->space->data + (block_num +USERSAPCE_OFSET) * BLOCK_SIZE);
-        int num_entries = BLOCK_SIZE / sizeof(dir_entry_t);
-        
-        for (int j = 0; j < num_entries; j++) {
-            if (dir_entries[j].inode_num == 0) {
-                dir_block = block_num;
-                entry_index = j;
-                break;
-            }
-        }
-        
-        if (dir_block != -1) break;
-    }
-    
-    if (dir_block == -1) {
+    // Créer l'entrée de répertoire pour le fichier de destination
+    if (add_dir_entry(part, dest_dir_inode, dest_filename, source_inode) != 0) {
         printf("Erreur: Repertoire de destination plein\n");
         return -1;
     }
     
-    // Créer l'entrée de répertoire pour le fichier de destination
-    dir_entries = (dir_entry_t *)(part->space->data +( dir_block +USERSAPCE_OFSET)* BLOCK_SIZE);
-    dir_entries[entry_index].inode_num = source_inode;
-    strncpy(dir_entries[entry_index].name, dest_filename, MAX_NAME_LENGTH - 1);
-    dir_entries[entry_index].name[MAX_NAME_LENGTH - 1] = '\0';
-    
-    // Mettre à jour la taille du répertoire de destination
-    part->inodes[dest_dir_inode].size += sizeof(dir_entry_t);
-    part->inodes[dest_dir_inode].mtime = time(NULL);
-    
 
     if(mode==COPYMODE){
         printf("la copy est realise \n");
         return 0;
     }
     // Supprimer l'entrée de répertoire pour le fichier source
-    for (int i = 0; i < NUM_DIRECT_BLOCKS; i++) {
-        int block_num = part->inodes[source_parent_inode].direct_blocks[i];
-        if (block_num == -1) continue;
-        
-        dir_entries = (dir_entry_t *)(part->space->data + (block_num +USERSAPCE_OFSET) * BLOCK_SIZE);
-        int num_entries = BLOCK_SIZE / sizeof(dir_entry_t);
-        
-        for (int j = 0; j < num_entries; j++) {
-            if (dir_entries[j].inode_num == source_inode && strcmp(dir_entries[j].name, source_filename) == 0) {
-                // Effacer cette entrée
-                memset(&dir_entries[j], 0, sizeof(dir_entry_t));
-                
-                // Mettre à jour le temps de modification du répertoire source
-                part->inodes[source_parent_inode].mtime = time(NULL);
-                
-                printf("Fichier '%s' deplace vers '%s'\n", source_path, dest_path);
-                return 0;
-            }
+    if (remove_dir_entry(part, source_parent_inode, source_filename) == 0) {
+        // Un répertoire déplacé change de parent: mettre à jour son entrée ".."
+        if ((part->inodes[source_inode].mode & 040000) && source_parent_inode != dest_dir_inode) {
+            set_parent_entry(part, source_inode, dest_dir_inode);
+            part->inodes[source_parent_inode].links_count--;
+            part->inodes[dest_dir_inode].links_count++;
         }
+        printf("Fichier '%s' deplace vers '%s'\n", source_path, dest_path);
+        return 0;
     }
 
     
     printf("Avertissement: Entree source non trouvee dans le repertoire\n");
     return 0;
 }
-
-/**
- * @brief Fonction pour écrire des données dans un fichier.
- *
- * Cette fonction permet d'écrire des données dans un fichier. Si le fichier n'existe pas,
- * il est créé. Les données sont écrites dans des blocs de taille fixe. Si le fichier existe,
- * les anciens blocs sont libérés et de nouveaux blocs sont alloués si nécessaire.
- *
- * @param part La partition où se trouvent les fichiers.
- * @param name Le nom du fichier dans lequel écrire.
- * @param data Les données à écrire dans le fichier.
- * @param size La taille des données à écrire.
- * @return Le nombre d'octets écrits, ou -1 en cas d'erreur, ou -2 si les permissions sont insuffisantes.
- */
-
-int write_to_file(partition_t *part, const char *name, const char *data, int size) {
-    
-    // Trouver l'inode du fichier par son nom
-    int inode_num = find_file_in_dir(part, part->current_dir_inode, name);
-    
-    // Si le fichier n'existe pas, le créer
-    if (inode_num < 0) {
-        inode_num = create_file(part, name, 0100644); // -rw-r--r--
-        if (inode_num < 0) return -1; // Échec de création
-    }
-    if (!check_permission(part, inode_num, 2)) return -2; // Pas de permission
-    // Calculer combien de blocs sont nécessaires
-    int blocks_needed = (size + BLOCK_SIZE - 1) / BLOCK_SIZE;
-    
-    // Libérer les anciens blocs si le fichier existe déjà
-    for (int i = 0; i < NUM_DIRECT_BLOCKS; i++) {
-        if (part->inodes[inode_num].direct_blocks[i] != -1) {
-            free_block(part, part->inodes[inode_num].direct_blocks[i]);
-            part->inodes[inode_num].direct_blocks[i] = -1;
-        }
-    }
-    
-    // Écrire les données dans les nouveaux blocs
-    int remaining = size;
-    int offset = 0;
-    
-    for (int i = 0; i < blocks_needed && i < NUM_DIRECT_BLOCKS; i++) {
-        // Allouer un nouveau bloc
-        int block_num = allocate_block(part);
-        if (block_num < 0) return -1; // Plus d'espace disponible
-        
-        part->inodes[inode_num].direct_blocks[i] = block_num;
-        
-        // Déterminer combien d'octets écrire dans ce bloc
-        int write_size = (remaining > BLOCK_SIZE) ? BLOCK_SIZE : remaining;
-        
-        // Copier les données dans le bloc
-        memcpy(part->space->data + (block_num + USERSAPCE_OFSET) * BLOCK_SIZE, data + offset, write_size);
-        
-        offset += write_size;
-        remaining -= write_size;
-    }
-    
-    // Mettre à jour la taille du fichier
-    part->inodes[inode_num].size = size;
-    part->inodes[inode_num].mtime = time(NULL);
-    
-    return size;
-}
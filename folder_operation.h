@@ -15,13 +15,11 @@
 
 
 int change_directory(partition_t *part, const char *name);
-void list_directory(partition_t *part,char* parem);
+void list_directory(partition_t *part,char* parem, int flags);
 void print_current_path(partition_t *part);
+int get_current_path(partition_t *part, char *buffer, size_t size);
 int add_dir_entry(partition_t *part, int dir_inode, const char *name, int inode_num);
 int remove_dir_entry(partition_t *part, int dir_inode, const char *name);
-int resolve_path(partition_t *part, const char *path, int *parent_inode);
-void split_path(const char *path, path_components_t *components);
-int write_to_file(partition_t *part, const char *name, const char *data, int size);
 
 int move_file_with_paths(partition_t *part, const char *source_path, const char *dest_path,int mode);
 void extract_filename(const char *path, char *filename);
@@ -10,97 +10,200 @@
 
 #include "init.h"
 
+/**
+ * @brief Vérifie qu'une géométrie de partition est utilisable.
+ *
+ * La taille de bloc doit être une puissance de 2 comprise entre MIN_BLOCK_SIZE
+ * et MAX_BLOCK_SIZE, il doit rester au moins un bloc de données une fois les
+ * métadonnées (superbloc, bitmaps, table d'inodes) placées, et la partition
+ * entière ne doit pas dépasser INT_MAX octets.
+ *
+ * @param geom Géométrie à vérifier.
+ * @return 0 si la géométrie est valide, -1 sinon (un message est affiché).
+ */
+int validate_geometry(const partition_geometry_t *geom) {
+    if (geom->block_size < MIN_BLOCK_SIZE || geom->block_size > MAX_BLOCK_SIZE ||
+        (geom->block_size & (geom->block_size - 1)) != 0) {
+        printf("Erreur: Taille de bloc invalide (%d), puissance de 2 entre %d et %d attendue\n",
+               geom->block_size, MIN_BLOCK_SIZE, MAX_BLOCK_SIZE);
+        return -1;
+    }
+    if (geom->num_inodes < MIN_NUM_INODES) {
+        printf("Erreur: Nombre d'inodes invalide (%d)\n", geom->num_inodes);
+        return -1;
+    }
+
+    superblock_t layout;
+    compute_layout(geom, &layout);
+    if (geom->num_blocks <= layout.first_data_block) {
+        printf("Erreur: Nombre de blocs invalide (%d), au moins %d necessaires\n",
+               geom->num_blocks, layout.first_data_block + 1);
+        return -1;
+    }
+    // Les offsets dans l'espace sont calculés en int
+    if ((size_t)geom->num_blocks * geom->block_size > INT_MAX) {
+        printf("Erreur: Partition trop grande (maximum %d octets)\n", INT_MAX);
+        return -1;
+    }
+    return 0;
+}
+
+
+/**
+ * @brief Calcule l'emplacement des métadonnées pour une géométrie donnée.
+ *
+ * Le superbloc occupe le bloc 0, suivi du bitmap des blocs, du bitmap des
+ * inodes (et de son summary), puis de la table d'inodes. Les données
+ * commencent au bloc suivant (first_data_block).
+ *
+ * @param geom Géométrie de la partition.
+ * @param sb Superbloc dans lequel écrire la géométrie et les emplacements.
+ */
+void compute_layout(const partition_geometry_t *geom, superblock_t *sb) {
+    size_t bs = geom->block_size;
+    size_t block_bitmap_bytes = BITMAP_WORDS(geom->num_blocks) * sizeof(uint64_t);
+    size_t inode_words = BITMAP_WORDS(geom->num_inodes);
+    size_t inode_bitmap_bytes = (inode_words + BITMAP_WORDS(inode_words)) * sizeof(uint64_t);
+    size_t inode_table_bytes = (size_t)geom->num_inodes * sizeof(inode_t);
+
+    sb->block_size = geom->block_size;
+    sb->num_blocks = geom->num_blocks;
+    sb->num_inodes = geom->num_inodes;
+    sb->inode_size = sizeof(inode_t);
+    sb->block_bitmap_block = SUPERBLOCK_OFSET + 1;
+    sb->inode_bitmap_block = sb->block_bitmap_block + (block_bitmap_bytes + bs - 1) / bs;
+    sb->inode_table_block = sb->inode_bitmap_block + (inode_bitmap_bytes + bs - 1) / bs;
+    sb->first_data_block = sb->inode_table_block + (inode_table_bytes + bs - 1) / bs;
+}
+
+
+/**
+ * @brief Positionne les pointeurs de la partition d'après son superbloc.
+ *
+ * Recopie la géométrie du superbloc dans la partition et fait pointer les
+ * bitmaps et la table d'inodes vers leurs blocs dans part->space->data.
+ * Utilisée à l'initialisation et au chargement.
+ *
+ * @param part Partition dont part->space contient déjà un superbloc valide.
+ */
+void setup_partition_layout(partition_t *part) {
+    part->superblock = (superblock_t*)(part->space->data + SUPERBLOCK_OFSET);
+
+    part->block_size = part->superblock->block_size;
+    part->num_blocks = part->superblock->num_blocks;
+    part->num_inodes = part->superblock->num_inodes;
+    part->first_data_block = part->superblock->first_data_block;
+
+    part->block_bitmap = (uint64_t*)(part->space->data + (size_t)part->superblock->block_bitmap_block * part->block_size);
+    part->inode_bitmap = (uint64_t*)(part->space->data + (size_t)part->superblock->inode_bitmap_block * part->block_size);
+    part->inode_summary = part->inode_bitmap + BITMAP_WORDS(part->num_inodes);
+    part->inodes = (inode_t*)(part->space->data + (size_t)part->superblock->inode_table_block * part->block_size);
+}
+
+
 /**
  * @brief Initialise les structures d'une partition.
- * 
+ *
  * Cette fonction initialise les éléments essentiels d'une partition : le superbloc,
  * les bitmaps des blocs et des inodes, la table des inodes, ainsi que les entrées
  * de répertoire de base (comme le répertoire racine). Elle configure également les
  * attributs de la partition, tels que l'utilisateur actuel et le répertoire courant.
- * 
- * @param part Pointeur vers la partition à initialiser.
+ *
+ * @param part Pointeur vers la partition à initialiser. part->space doit contenir
+ *        au moins geom->num_blocks * geom->block_size octets.
+ * @param geom Géométrie de la partition (déjà validée).
  */
-void init_partition(partition_t *part) {
-
-
-    // Initialiser les pointeurs vers les zones dans part->space->data
-    part->superblock = (superblock_t*)(part->space->data + SUPERBLOCK_OFSET * BLOCK_SIZE);
-    
-    // Initialiser le bitmap des blocs
-    part->block_bitmap = (block_bitmap_t*)(part->space->data + BLOCKB_OFSET* BLOCK_SIZE );
-    
-
-    // Initialiser le bitmap des inodes
-    part->inode_bitmap = (inode_bitmap_t*)(part->space->data + INODEB_OFSET * BLOCK_SIZE);
-    
-    // Initialiser la table d'inodes
-    part->inodes = (inode_t*)(part->space->data + INODE_OFSET * BLOCK_SIZE);
-    memset(part->inodes, 0, sizeof(inode_t) * MAX_INODES); // S'assurer que la mémoire est initialisée
-    
+void init_partition(partition_t *part, const partition_geometry_t *geom) {
+
+    // Configurer le superbloc puis les pointeurs vers les zones dans part->space->data
+    superblock_t *sb = (superblock_t*)(part->space->data + SUPERBLOCK_OFSET);
+    memset(sb, 0, sizeof(superblock_t));
+    compute_layout(geom, sb);
+    setup_partition_layout(part);
+
+    // S'assurer que la mémoire de la table d'inodes est initialisée
+    memset(part->inodes, 0, sizeof(inode_t) * part->num_inodes);
+
     // Initialiser d'autres éléments de la partition
     part->current_dir_inode = 0; // Root directory
-    
-    // Configurer le superbloc
-    part->superblock->magic = 0x12345678;
-    part->superblock->num_blocks = MAX_BLOCKS;
-    part->superblock->num_inodes = MAX_INODES;
-    part->superblock->first_data_block = USERSAPCE_OFSET;
-    part->superblock->block_size = BLOCK_SIZE;
-    part->superblock->inode_size = sizeof(inode_t);
-    part->superblock->blocks_per_group = MAX_BLOCKS;
-    part->superblock->inodes_per_group = MAX_INODES;
-    part->superblock->free_blocks_count = MAX_BLOCKS - USERSAPCE_OFSET;
-    part->superblock->free_inodes_count = MAX_INODES - 1; // Le premier inode est réservé pour le répertoire racine
-    
-    // Initialiser les bitmaps - utiliser des offsets directs pour l'initialisation
-    unsigned char* block_bitmap_data = (unsigned char*)(part->space->data + BLOCKB_OFSET * BLOCK_SIZE);
-    unsigned char* inode_bitmap_data = (unsigned char*)(part->space->data + INODEB_OFSET * BLOCK_SIZE);
-    
-    memset(block_bitmap_data, 0, MAX_BLOCKS / 8 + 1);
-    memset(inode_bitmap_data, 0, MAX_INODES / 8 + 1);
-    
+
+    part->superblock->magic = PARTITION_MAGIC;
+    part->superblock->blocks_per_group = part->num_blocks;
+    part->superblock->inodes_per_group = part->num_inodes;
+    part->superblock->free_blocks_count = part->num_blocks - part->first_data_block - 1; // Moins le bloc racine
+    part->superblock->free_inodes_count = part->num_inodes - 1; // Le premier inode est réservé pour le répertoire racine
+
+    // Initialiser les bitmaps
+    uint64_t* block_bitmap_data = part->block_bitmap;
+    uint64_t* inode_bitmap_data = part->inode_bitmap;
+    int block_words = BITMAP_WORDS(part->num_blocks);
+    int inode_words = BITMAP_WORDS(part->num_inodes);
+
+    memset(block_bitmap_data, 0, block_words * sizeof(uint64_t));
+    memset(inode_bitmap_data, 0, (inode_words + BITMAP_WORDS(inode_words)) * sizeof(uint64_t));
+
     // Marquer les blocs système comme utilisés
-    for (int i = 0; i < USERSAPCE_OFSET; i++) {
+    for (int i = 0; i < part->first_data_block; i++) {
         // Marquer le bloc comme utilisé dans le bitmap
-        block_bitmap_data[i / 8] |= (1 << (i % 8));
+        block_bitmap_data[i / BITMAP_WORD_BITS] |= 1ULL << (i % BITMAP_WORD_BITS);
+    }
+
+    // Les bits de bourrage après num_blocks ne doivent jamais paraître libres
+    for (int i = part->num_blocks; i < block_words * BITMAP_WORD_BITS; i++) {
+        block_bitmap_data[i / BITMAP_WORD_BITS] |= 1ULL << (i % BITMAP_WORD_BITS);
+    }
+    for (int i = part->num_inodes; i < inode_words * BITMAP_WORD_BITS; i++) {
+        inode_bitmap_data[i / BITMAP_WORD_BITS] |= 1ULL << (i % BITMAP_WORD_BITS);
     }
-    
+
     // Créer le répertoire racine (inode 0)
-    inode_bitmap_data[0 / 8] |= (1 << (0 % 8)); // Marquer l'inode 0 comme utilisé
+    inode_bitmap_data[0] |= 1ULL; // Marquer l'inode 0 comme utilisé
+    rebuild_inode_summary(part);
 
     // Initialiser l'utilisateur courant (root par défaut)
     part->current_user.id = 0;
     strcpy(part->current_user.name, "root");
     part->current_user.group_id = 0;
-    
+
     // Initialiser l'inode du répertoire racine
     part->inodes[0].mode = 0040755; // Répertoire avec permission rwxr-xr-x
     part->inodes[0].uid = 0; // root
     part->inodes[0].gid = 0; // root
-    part->inodes[0].size = 2 * sizeof(dir_entry_t); // "." et ".."
+    part->inodes[0].size = DIR_REC_LEN(1) + DIR_REC_LEN(2); // "." et ".."
     part->inodes[0].ctime = part->inodes[0].mtime = part->inodes[0].atime = time(NULL);
     part->inodes[0].links_count = 2;  // . et ..
 
     // Allouer un bloc pour le répertoire racine (simulé ici)
-    int root_block = USERSAPCE_OFSET; // Premier bloc disponible
-    block_bitmap_data[root_block / 8] |= (1 << (root_block % 8)); // Marquer comme utilisé
-    
-    part->inodes[0].direct_blocks[0] = root_block;
-    
-    // Initialiser les entrées de répertoire "." et ".."
-    dir_entry_t entries[2];
-    entries[0].inode_num = 0;
-    strcpy(entries[0].name, ".");
-    entries[1].inode_num = 0;
-    strcpy(entries[1].name, "..");
-    
-    // Écrire les entrées dans le bloc du répertoire racine
-    memcpy(part->space->data + root_block * BLOCK_SIZE, entries, sizeof(entries));
-
-
-    part->inode_bitmap->bitmap[0] |= 1;
-    
+    int root_block = part->first_data_block; // Premier bloc disponible
+    block_bitmap_data[root_block / BITMAP_WORD_BITS] |= 1ULL << (root_block % BITMAP_WORD_BITS); // Marquer comme utilisé
+
+    // Les inodes stockent des numéros de blocs logiques (relatifs à first_data_block)
+    clear_block_map(&part->inodes[0]);
+    part->inodes[0].dir_index_block = -1;
+    part->inodes[0].direct_blocks[0] = root_block - part->first_data_block;
+    part->inodes[0].dir_blocks = 1;
+    part->inodes[0].dir_count = 2;
+
+    // Écrire les entrées "." et ".." dans le bloc du répertoire racine;
+    // ".." s'étend jusqu'à la fin du bloc
+    char *block = part->space->data + (size_t)root_block * part->block_size;
+    memset(block, 0, part->block_size);
+    dir_entry_t *dot = (dir_entry_t *)block;
+    dot->inode_num = 0;
+    dot->rec_len = DIR_REC_LEN(1);
+    dot->name_len = 1;
+    dot->file_type = DIR_FT_DIR;
+    strcpy(dot->name, ".");
+    dir_entry_t *dotdot = (dir_entry_t *)(block + DIR_REC_LEN(1));
+    dotdot->inode_num = 0;
+    dir_set_rec_len(dotdot, part->block_size - DIR_REC_LEN(1));
+    dotdot->name_len = 2;
+    dotdot->file_type = DIR_FT_DIR;
+    strcpy(dotdot->name, "..");
+
     // Définir le répertoire courant à la racine
     part->current_dir_inode = 0;
 
+    // La recherche de blocs libres commence au début de l'espace utilisateur
+    part->next_free_block = part->first_data_block;
 }
@@ -8,7 +8,12 @@
 #include <fcntl.h>
 #include "structure.h"
 #include "load.h"
+#include "inode.h"
+#include "dir_entry.h"
 
-void init_partition(partition_t *part);
+int validate_geometry(const partition_geometry_t *geom);
+void compute_layout(const partition_geometry_t *geom, superblock_t *sb);
+void setup_partition_layout(partition_t *part);
+void init_partition(partition_t *part, const partition_geometry_t *geom);
 
 #endif // INIT_H
\ No newline at end of file
@@ -7,79 +7,479 @@
  * dans une partition simulée.
  */
 #include "inode.h"
+#include "dir_index.h"
+#include "dcache.h"
+
+
+/**
+ * @brief Reconstruit le niveau summary du bitmap des inodes.
+ * 
+ * Recalcule, pour chaque mot du bitmap, le bit "contient un inode libre".
+ * Appelée après l'initialisation et après le chargement d'une partition.
+ * 
+ * @param part Pointeur vers la partition.
+ */
+void rebuild_inode_summary(partition_t *part) {
+    int inode_words = BITMAP_WORDS(part->num_inodes);
+    memset(part->inode_summary, 0, BITMAP_WORDS(inode_words) * sizeof(uint64_t));
+    for (int w = 0; w < inode_words; w++) {
+        if (~part->inode_bitmap[w] != 0) {
+            part->inode_summary[w / BITMAP_WORD_BITS] |= 1ULL << (w % BITMAP_WORD_BITS);
+        }
+    }
+}
 
 
 /**
  * @brief Alloue un inode libre dans la partition.
  * 
- * Cherche un inode libre dans la bitmap, le marque comme utilisé,
- * initialise sa structure et met à jour le superbloc.
+ * Cherche un inode libre grâce au summary (premier mot du bitmap ayant un bit
+ * libre), le marque comme utilisé, initialise sa structure et met à jour le
+ * superbloc. Le summary est mis à jour si le mot devient plein.
  * 
  * @param part Pointeur vers la partition où allouer l'inode.
  * @return L'indice de l'inode alloué en cas de succès, -1 en cas d'échec (plus d'inodes disponibles).
  */
 int allocate_inode(partition_t *part) {
-    // Chercher un inode libre
-    for (int i = 0; i < MAX_INODES; i++) {
-        int byte_index = i / 8;
-        int bit_index = i % 8;
-        if (!(part->inode_bitmap->bitmap[byte_index] & (1 << bit_index))) {
-            // Marquer l'inode comme utilisé
-            part->inode_bitmap->bitmap[byte_index] |= (1 << bit_index);
-            part->superblock->free_inodes_count--;
-            
-            // Initialiser l'inode
-            memset(&part->inodes[i], 0, sizeof(inode_t));
-            for (int j = 0; j < NUM_DIRECT_BLOCKS; j++) {
-                part->inodes[i].direct_blocks[j] = -1;
-            }
-            part->inodes[i].indirect_block = -1;
-            part->inodes[i].ctime = time(NULL);
-            part->inodes[i].atime = time(NULL);
-            part->inodes[i].mtime = time(NULL);
-            
-            return i;
+    // Chercher un mot du bitmap qui a un inode libre
+    int summary_words = BITMAP_WORDS(BITMAP_WORDS(part->num_inodes));
+    for (int s = 0; s < summary_words; s++) {
+        uint64_t summary = part->inode_summary[s];
+        if (summary == 0) continue;
+        
+        int w = s * BITMAP_WORD_BITS + __builtin_ctzll(summary);
+        uint64_t free_bits = ~part->inode_bitmap[w];
+        int i = w * BITMAP_WORD_BITS + __builtin_ctzll(free_bits);
+        if (i >= part->num_inodes) return -1;  // Seuls les bits de bourrage restent
+        
+        // Marquer l'inode comme utilisé
+        part->inode_bitmap[w] |= 1ULL << (i % BITMAP_WORD_BITS);
+        if (~part->inode_bitmap[w] == 0) {
+            part->inode_summary[s] &= ~(1ULL << (w % BITMAP_WORD_BITS));
         }
+        part->superblock->free_inodes_count--;
+        
+        // Initialiser l'inode
+        memset(&part->inodes[i], 0, sizeof(inode_t));
+        clear_block_map(&part->inodes[i]);
+        part->inodes[i].dir_index_block = -1;
+        part->inodes[i].ctime = time(NULL);
+        part->inodes[i].atime = time(NULL);
+        part->inodes[i].mtime = time(NULL);
+        
+        return i;
     }
     return -1;  // Pas d'inode libre
 }
 
 
 /**
- * @brief Libère un inode et tous les blocs associés dans la partition.
+ * @brief Remet à vide la table de blocs d'un inode.
+ * 
+ * Tous les pointeurs (directs, indirects simple, double et triple) valent -1
+ * et l'inode repasse en représentation par blocs (sans INODE_FL_EXTENTS ni
+ * INODE_FL_INLINE).
+ * Les blocs eux-mêmes ne sont pas libérés.
  * 
- * Marque l'inode comme libre dans la bitmap, libère les blocs de données directs
- * ainsi que le bloc indirect s'il existe, et réinitialise la structure de l'inode.
+ * @param inode Inode à réinitialiser.
+ */
+void clear_block_map(inode_t *inode) {
+    inode->flags &= ~(INODE_FL_EXTENTS | INODE_FL_INLINE);
+    for (int i = 0; i < NUM_DIRECT_BLOCKS; i++) {
+        inode->direct_blocks[i] = -1;
+    }
+    inode->indirect_block = -1;
+    inode->double_indirect_block = -1;
+    inode->triple_indirect_block = -1;
+}
+
+
+/**
+ * @brief Alloue une table d'indirection dont toutes les entrées valent -1.
+ * 
+ * @param part Pointeur vers la partition.
+ * @return Le numéro logique du bloc alloué, ou -1 si la partition est pleine.
+ */
+static int allocate_table(partition_t *part) {
+    int block_num = allocate_block(part);
+    if (block_num == -1) return -1;
+    
+    int *table = (int *)block_ptr(part, block_num);
+    for (int i = 0; i < (int)(part->block_size / sizeof(int)); i++) {
+        table[i] = -1;
+    }
+    return block_num;
+}
+
+
+/**
+ * @brief Libère une table d'indirection et tout ce qu'elle référence.
+ * 
+ * @param part Pointeur vers la partition.
+ * @param block_num Bloc de la table (ou bloc de données si level vaut 0).
+ * @param level Niveau d'indirection: 1 pour une table de blocs de données.
+ */
+static void free_indirect_tree(partition_t *part, int block_num, int level) {
+    if (level > 0) {
+        int *table = (int *)block_ptr(part, block_num);
+        for (int i = 0; i < (int)(part->block_size / sizeof(int)); i++) {
+            if (table[i] != -1) {
+                free_indirect_tree(part, table[i], level - 1);
+            }
+        }
+    }
+    free_block(part, block_num);
+}
+
+
+/**
+ * @brief Libère tous les blocs de données d'un inode.
+ * 
+ * Gère les trois représentations: données inline (INODE_FL_INLINE, rien à
+ * libérer), extents (INODE_FL_EXTENTS) ou blocs directs plus arbres
+ * d'indirection simple, double et triple. L'index haché d'un répertoire est
+ * libéré aussi. Après l'appel l'inode n'a
+ * plus aucun bloc et utilise de nouveau la représentation par blocs.
  * 
  * @param part Pointeur vers la partition contenant l'inode.
- * @param inode_num Numéro (indice) de l'inode à libérer.
+ * @param inode_num Numéro de l'inode dont les blocs sont libérés.
  */
-void free_inode(partition_t *part, int inode_num) {
-    int byte_index = inode_num / 8;
-    int bit_index = inode_num % 8;
+void free_inode_blocks(partition_t *part, int inode_num) {
+    inode_t *inode = &part->inodes[inode_num];
     
-    // Libérer tous les blocs associés à l'inode
-    for (int i = 0; i < NUM_DIRECT_BLOCKS; i++) {
-        if (part->inodes[inode_num].direct_blocks[i] != -1) {
-            free_block(part, part->inodes[inode_num].direct_blocks[i]);
+    if (inode->flags & INODE_FL_INLINE) {
+        // Données dans l'inode: aucun bloc à libérer
+    } else if (inode->flags & INODE_FL_EXTENTS) {
+        for (int e = 0; e < inode->extent_count; e++) {
+            for (int b = 0; b < inode->extents[e].length; b++) {
+                free_block(part, inode->extents[e].start + b);
+            }
+        }
+    } else {
+        for (int i = 0; i < NUM_DIRECT_BLOCKS; i++) {
+            if (inode->direct_blocks[i] != -1) {
+                free_block(part, inode->direct_blocks[i]);
+            }
+        }
+        
+        // Libérer les arbres d'indirection s'ils sont présents
+        int roots[MAX_INDIRECT_LEVEL] = { inode->indirect_block, inode->double_indirect_block, inode->triple_indirect_block };
+        for (int level = 1; level <= MAX_INDIRECT_LEVEL; level++) {
+            if (roots[level - 1] != -1) {
+                free_indirect_tree(part, roots[level - 1], level);
+            }
+        }
+    }
+    
+    // Index haché d'un répertoire
+    dir_index_free(part, inode_num);
+    
+    clear_block_map(inode);
+    part->map_generation++;  // Les traductions gardées par les fichiers ouverts sont périmées
+}
+
+
+/**
+ * @brief Emplacement qui désigne le n-ième bloc d'un fichier par blocs.
+ * 
+ * Renvoie le bloc direct ou l'entrée de la table d'indirection feuille qui
+ * contient le numéro du bloc (-1 s'il n'est pas alloué). Avec @p create, les
+ * tables manquantes sont allouées, mais pas le bloc lui-même.
+ * 
+ * @return L'emplacement, ou NULL si une table manque (ou n'a pas pu être
+ *         allouée) ou si le bloc dépasse la taille maximale.
+ */
+static int *bmap_slot(partition_t *part, int inode_num, int file_block, int create, block_map_cache_t *cache) {
+    inode_t *inode = &part->inodes[inode_num];
+    
+    if (file_block < NUM_DIRECT_BLOCKS) {
+        return &inode->direct_blocks[file_block];
+    }
+    
+    // Trouver l'arbre d'indirection qui couvre ce bloc
+    int *roots[MAX_INDIRECT_LEVEL] = { &inode->indirect_block, &inode->double_indirect_block, &inode->triple_indirect_block };
+    long long per_block = part->block_size / sizeof(int);
+    long long rel = file_block - NUM_DIRECT_BLOCKS;
+    long long span = per_block;
+    int level = 1;
+    while (rel >= span) {
+        rel -= span;
+        span *= per_block;
+        if (++level > MAX_INDIRECT_LEVEL) return NULL;  // Au-delà de la taille maximale
+    }
+    
+    // Descendre l'arbre: à chaque niveau, span est le nombre de blocs couverts
+    int *slot = roots[level - 1];
+    for (; level >= 1; level--) {
+        if (*slot == -1) {
+            if (!create) return NULL;
+            *slot = allocate_table(part);
+            if (*slot == -1) return NULL;
+        }
+        span /= per_block;
+        int idx = rel / span;
+        rel %= span;
+        
+        if (level == 1 && cache != NULL) {
+            cache->inode_num = inode_num;
+            cache->first = file_block - idx;
+            cache->count = per_block;
+            cache->table_block = *slot;
+        }
+        slot = &((int *)block_ptr(part, *slot))[idx];
+    }
+    return slot;
+}
+
+
+/**
+ * @brief Traduit le n-ième bloc d'un fichier en bloc logique de la partition.
+ * 
+ * Pour un inode à extents, parcourt la liste des extents. Sinon utilise les
+ * blocs directs, puis les arbres d'indirection simple, double et triple. Avec
+ * @p create, les tables intermédiaires et le bloc de données manquants sont
+ * alloués (représentation par blocs uniquement).
+ * 
+ * Si @p cache est fourni, la dernière table feuille (ou le dernier extent)
+ * utilisée y est mémorisée: les blocs suivants couverts par cette table sont
+ * alors traduits sans redescendre l'arbre.
+ * 
+ * @param part Pointeur vers la partition contenant l'inode.
+ * @param inode_num Numéro de l'inode.
+ * @param file_block Indice du bloc dans le fichier (0 pour les premiers octets).
+ * @param create Si non nul, allouer le bloc s'il n'existe pas.
+ * @param cache Cache de traduction (inode_num à -1 pour un cache vide), ou NULL.
+ * @return Le numéro logique du bloc, ou -1 s'il n'est pas alloué (ou si
+ *         l'allocation a échoué).
+ */
+int inode_bmap(partition_t *part, int inode_num, int file_block, int create, block_map_cache_t *cache) {
+    inode_t *inode = &part->inodes[inode_num];
+    if (file_block < 0) return -1;
+    
+    // Un inode inline n'a pas de blocs; il doit être promu par l'appelant
+    if (inode->flags & INODE_FL_INLINE) return -1;
+    
+    // Bloc couvert par la dernière table ou le dernier extent utilisé
+    if (cache != NULL && cache->inode_num == inode_num &&
+        file_block >= cache->first && file_block < cache->first + cache->count) {
+        int idx = file_block - cache->first;
+        if (cache->table_block == -1) {
+            return cache->extent_start + idx;
+        }
+        int *table = (int *)block_ptr(part, cache->table_block);
+        if (table[idx] == -1 && create) {
+            table[idx] = allocate_block(part);
         }
+        return table[idx];
     }
     
-    // Libérer le bloc indirect si présent
-    if (part->inodes[inode_num].indirect_block != -1) {
-        int *indirect_table = (int *)(part->space->data + part->inodes[inode_num].indirect_block * BLOCK_SIZE);
-        for (int i = 0; i < BLOCK_SIZE / sizeof(int); i++) {
-            if (indirect_table[i] != -1) {
-                free_block(part, indirect_table[i]);
+    if (inode->flags & INODE_FL_EXTENTS) {
+        int first = 0;
+        for (int e = 0; e < inode->extent_count; e++) {
+            if (file_block < first + inode->extents[e].length) {
+                if (cache != NULL) {
+                    cache->inode_num = inode_num;
+                    cache->first = first;
+                    cache->count = inode->extents[e].length;
+                    cache->table_block = -1;
+                    cache->extent_start = inode->extents[e].start;
+                }
+                return inode->extents[e].start + (file_block - first);
             }
+            first += inode->extents[e].length;
         }
-        free_block(part, part->inodes[inode_num].indirect_block);
+        return -1;
     }
     
-    // Marquer l'inode comme libre
-    part->inode_bitmap->bitmap[byte_index] &= ~(1 << bit_index);
+    int *slot = bmap_slot(part, inode_num, file_block, create, cache);
+    if (slot == NULL) return -1;
+    if (*slot == -1 && create) {
+        *slot = allocate_block(part);
+    }
+    return *slot;
+}
+
+
+/**
+ * @brief Nombre de tables d'indirection nécessaires pour adresser num_blocks blocs.
+ */
+static int map_tables_needed(partition_t *part, int num_blocks) {
+    long long per_block = part->block_size / sizeof(int);
+    long long rel = num_blocks - NUM_DIRECT_BLOCKS;
+    long long span = per_block;
+    int tables = 0;
+    
+    // Chaque arbre d'indirection couvre span blocs; ses tables de chaque niveau en couvrent per_block^k
+    for (int level = 1; level <= MAX_INDIRECT_LEVEL && rel > 0; level++) {
+        long long covered = rel < span ? rel : span;
+        long long reach = 1;
+        for (int k = 1; k <= level; k++) {
+            reach *= per_block;
+            tables += (covered + reach - 1) / reach;
+        }
+        rel -= covered;
+        span *= per_block;
+    }
+    return tables;
+}
+
+
+/**
+ * @brief Passe un inode à extents en représentation par blocs, sans déplacer ses données.
+ * 
+ * Les blocs des extents sont repris tels quels par les blocs directs et les
+ * arbres d'indirection; seules les tables sont allouées. Sert quand un fichier
+ * doit grandir alors que ses NUM_EXTENTS extents sont utilisés.
+ * 
+ * @param part Pointeur vers la partition contenant l'inode.
+ * @param inode_num Numéro de l'inode (avec INODE_FL_EXTENTS).
+ * @return 0 en cas de succès, -1 s'il n'y a pas assez de blocs libres pour
+ *         les tables (l'inode est alors inchangé).
+ */
+int inode_extents_to_map(partition_t *part, int inode_num) {
+    inode_t *inode = &part->inodes[inode_num];
+    extent_t extents[NUM_EXTENTS];
+    int extent_count = inode->extent_count;
+    int num_blocks = 0;
+    
+    for (int e = 0; e < extent_count; e++) {
+        extents[e] = inode->extents[e];
+        num_blocks += extents[e].length;
+    }
+    if (map_tables_needed(part, num_blocks) > part->superblock->free_blocks_count) return -1;
+    
+    clear_block_map(inode);
+    part->map_generation++;
+    int file_block = 0;
+    for (int e = 0; e < extent_count; e++) {
+        for (int b = 0; b < extents[e].length; b++) {
+            *bmap_slot(part, inode_num, file_block++, 1, NULL) = extents[e].start + b;
+        }
+    }
+    return 0;
+}
+
+
+/**
+ * @brief Détache des fichiers ouverts un inode libéré (voir file_open).
+ * 
+ * Les descripteurs restent occupés jusqu'à file_close, mais leurs lectures et
+ * écritures échouent: le numéro d'inode peut être réattribué.
+ */
+static void forget_open_inode(partition_t *part, int inode_num) {
+    for (int fd = 0; fd < MAX_OPEN_FILES; fd++) {
+        if (part->files[fd].flags != 0 && part->files[fd].inode_num == inode_num) {
+            part->files[fd].inode_num = -1;
+        }
+    }
+}
+
+
+/**
+ * @brief Détache des parcours ouverts un répertoire libéré (voir open_directory).
+ * 
+ * Les curseurs restent valides jusqu'à close_directory, mais read_directory_batch
+ * échoue: le numéro d'inode peut être réattribué.
+ */
+static void forget_open_dir(partition_t *part, int inode_num) {
+    for (dir_stream_t *stream = part->dir_streams; stream != NULL; stream = stream->next) {
+        if (stream->dir_inode == inode_num) {
+            stream->dir_inode = -1;
+        }
+    }
+}
+
+
+/**
+ * @brief Libère un inode et tous les blocs associés dans la partition.
+ * 
+ * Marque l'inode comme libre dans la bitmap, libère ses blocs de données
+ * (voir free_inode_blocks), et réinitialise la structure de l'inode.
+ * 
+ * @param part Pointeur vers la partition contenant l'inode.
+ * @param inode_num Numéro (indice) de l'inode à libérer.
+ */
+void free_inode(partition_t *part, int inode_num) {
+    int word_index = inode_num / BITMAP_WORD_BITS;
+    int bit_index = inode_num % BITMAP_WORD_BITS;
+    
+    // Libérer tous les blocs associés à l'inode
+    free_inode_blocks(part, inode_num);
+    if (part->open_files > 0) forget_open_inode(part, inode_num);
+    if (part->dir_streams != NULL) forget_open_dir(part, inode_num);
+    
+    // Le numéro pourra resservir: oublier les noms en cache de ce répertoire
+    if (part->inodes[inode_num].mode & 040000) {
+        dcache_forget_dir(part, inode_num);
+    }
+    
+    // Marquer l'inode comme libre, son mot a désormais un bit libre
+    part->inode_bitmap[word_index] &= ~(1ULL << bit_index);
+    part->inode_summary[word_index / BITMAP_WORD_BITS] |= 1ULL << (word_index % BITMAP_WORD_BITS);
     part->superblock->free_inodes_count++;
     
     // Réinitialiser l'inode
     memset(&part->inodes[inode_num], 0, sizeof(inode_t));
 }
+
+
+/**
+ * @brief Libère un ensemble d'inodes d'un coup (par exemple un sous-arbre supprimé).
+ * 
+ * Fait le travail de free_inode pour chaque inode, mais les blocs sont rendus
+ * au bitmap en une seule passe à la fin (voir block_batch_begin) et les caches
+ * des répertoires libérés sont vidés en un seul balayage.
+ * 
+ * @param part Pointeur vers la partition.
+ * @param inodes Numéros des inodes à libérer (chacun une seule fois).
+ * @param count Nombre d'inodes.
+ */
+void free_inodes(partition_t *part, const int *inodes, int count) {
+    block_batch_t batch;
+    block_batch_begin(part, &batch);
+    
+    int dirs = 0;
+    for (int i = 0; i < count; i++) {
+        int inode_num = inodes[i];
+        int word_index = inode_num / BITMAP_WORD_BITS;
+        
+        free_inode_blocks(part, inode_num);
+        if (part->open_files > 0) forget_open_inode(part, inode_num);
+        if (part->dir_streams != NULL) forget_open_dir(part, inode_num);
+        if (part->inodes[inode_num].mode & 040000) dirs++;
+        
+        part->inode_bitmap[word_index] &= ~(1ULL << (inode_num % BITMAP_WORD_BITS));
+        part->inode_summary[word_index / BITMAP_WORD_BITS] |= 1ULL << (word_index % BITMAP_WORD_BITS);
+        memset(&part->inodes[inode_num], 0, sizeof(inode_t));
+    }
+    part->superblock->free_inodes_count += count;
+    
+    block_batch_end(part);
+    
+    // Les numéros pourront resservir: oublier les noms en cache des répertoires libérés
+    if (dirs > 0) {
+        dcache_forget_freed(part, inodes, count);
+    }
+}
+
+
+/**
+ * @brief Donne la cible d'un lien symbolique.
+ * 
+ * La cible est stockée dans l'inode (INODE_FL_INLINE) quand elle tient dans
+ * INODE_INLINE_SIZE octets, sinon dans le premier bloc de données.
+ * 
+ * @param part Pointeur vers la partition contenant l'inode.
+ * @param inode_num Numéro de l'inode du lien.
+ * @return La cible terminée par '\0', ou NULL si le lien est corrompu.
+ */
+const char *symlink_target(partition_t *part, int inode_num) {
+    inode_t *inode = &part->inodes[inode_num];
+    
+    if (inode->flags & INODE_FL_INLINE) {
+        return inode->inline_data;
+    }
+    int data_block = inode_bmap(part, inode_num, 0, 0, NULL);
+    if (data_block == -1) return NULL;
+    return block_ptr(part, data_block);
+}
@@ -10,6 +10,13 @@
 #include "block.h"
 int allocate_inode(partition_t *part);
 void free_inode(partition_t *part, int inode_num);
+void free_inodes(partition_t *part, const int *inodes, int count);
+void rebuild_inode_summary(partition_t *part);
+void free_inode_blocks(partition_t *part, int inode_num);
+void clear_block_map(inode_t *inode);
+int inode_bmap(partition_t *part, int inode_num, int file_block, int create, block_map_cache_t *cache);
+int inode_extents_to_map(partition_t *part, int inode_num);
+const char *symlink_target(partition_t *part, int inode_num);
 
 #endif // INODE_H
 
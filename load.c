@@ -7,12 +7,34 @@
  */
 
 #include "load.h"
+#include "inode.h"
+#include "dcache.h"
+#include "dir_entry.h"
+#include "orphan.h"
+#include "file_table.h"
 
 partition_t *global_partition = NULL;
 
+/**
+ * @brief Alloue un espace utilisable de la taille donnee, initialise a zero.
+ * 
+ * @param size Taille de la zone de donnees en octets.
+ * @return Pointeur vers l'espace alloue, ou NULL en cas d'echec.
+ */
+static espace_utilisable_t* allocate_space(size_t size) {
+    espace_utilisable_t *space = (espace_utilisable_t*)calloc(1, sizeof(espace_utilisable_t) + size);
+    if (space != NULL) {
+        space->size = size;
+    }
+    return space;
+}
+
 /**
  * @brief Sauvegarde l'etat actuel de la partition dans un fichier.
  * 
+ * Le superbloc est ecrit en tete pour que le chargement connaisse la geometrie,
+ * suivi de l'espace complet (bitmaps et table d'inodes compris).
+ * 
  * @param part Pointeur vers la partition à sauvegarder.
  * @param filename Nom du fichier où sauvegarder la partition.
  * @return 0 en cas de succès, -1 en cas d'erreur.
@@ -28,17 +50,8 @@ int save_partition(partition_t *part, const char *filename) {
     // D'abord la structure du superblock
     fwrite(part->superblock, sizeof(superblock_t), 1, file);
     
-    // Ensuite la bitmap des blocs
-    fwrite(part->block_bitmap, sizeof(block_bitmap_t), 1, file);
-    
-    // La bitmap des inodes
-    fwrite(part->inode_bitmap, sizeof(inode_bitmap_t), 1, file);
-    
-    // La table d'inodes complète
-    fwrite(part->inodes, sizeof(inode_t), MAX_INODES, file);
-    
-    // Les données utilisateur (l'espace complet)
-    fwrite(part->space->data, sizeof(char), PARTITION_SIZE, file);
+    // Les données (l'espace complet, qui contient bitmaps et table d'inodes)
+    fwrite(part->space->data, sizeof(char), part->space->size, file);
     
     // Informations supplémentaires sur l'état courant
     fwrite(&part->current_dir_inode, sizeof(int), 1, file);
@@ -49,9 +62,237 @@ int save_partition(partition_t *part, const char *filename) {
     return 0;
 }
 
+/**
+ * @brief Lit la suite d'un fichier au format actuel: fin du superbloc et espace complet.
+ * 
+ * @param file Fichier positionne apres la partie commune du superbloc.
+ * @param sb Superbloc, dont la partie commune est deja lue; complete ici.
+ * @return L'espace lu, ou NULL en cas d'erreur (un message est affiche).
+ */
+static espace_utilisable_t* read_space(FILE *file, superblock_t *sb) {
+    // Les formats précédents s'arrêtent avant la liste des orphelins
+    size_t sb_end = sb->magic == PARTITION_MAGIC ? sizeof(superblock_t) : offsetof(superblock_t, orphan_count);
+    if (fread(&sb->block_bitmap_block, sb_end - offsetof(superblock_t, block_bitmap_block), 1, file) != 1) {
+        printf("Erreur: Lecture du superblock echouee\n");
+        return NULL;
+    }
+    
+    // Verifier que la geometrie et l'emplacement des metadonnees sont coherents
+    partition_geometry_t geom = { sb->block_size, sb->num_blocks, sb->num_inodes };
+    superblock_t expected;
+    if (validate_geometry(&geom) != 0) {
+        return NULL;
+    }
+    compute_layout(&geom, &expected);
+    if (sb->inode_size != (int)sizeof(inode_t) ||
+        sb->block_bitmap_block != expected.block_bitmap_block ||
+        sb->inode_bitmap_block != expected.inode_bitmap_block ||
+        sb->inode_table_block != expected.inode_table_block ||
+        sb->first_data_block != expected.first_data_block) {
+        printf("Erreur: Disposition de la partition incompatible\n");
+        return NULL;
+    }
+    
+    // Allouer l'espace correspondant a la geometrie du fichier
+    espace_utilisable_t *space = allocate_space((size_t)sb->num_blocks * sb->block_size);
+    if (space == NULL) {
+        printf("Erreur: Impossible d'allouer de la memoire pour la partition\n");
+        return NULL;
+    }
+    
+    // Lire les donnees de l'espace utilisable
+    if (fread(space->data, sizeof(char), space->size, file) != space->size) {
+        printf("Erreur: Lecture des donnees de la partition echouee\n");
+        free(space);
+        return NULL;
+    }
+    return space;
+}
+
+/**
+ * @brief Marque un bloc de données de la partition convertie comme utilisé.
+ * 
+ * @return 0, ou -1 si le bloc n'existe pas ou est déjà utilisé par un autre inode.
+ */
+static int baseline_claim_block(partition_t *part, int block_num) {
+    if (block_num < 0 || block_num >= part->num_blocks - part->first_data_block) return -1;
+    int bit = part->first_data_block + block_num;
+    uint64_t mask = 1ULL << (bit % BITMAP_WORD_BITS);
+    if (part->block_bitmap[bit / BITMAP_WORD_BITS] & mask) return -1;
+    part->block_bitmap[bit / BITMAP_WORD_BITS] |= mask;
+    part->superblock->free_blocks_count--;
+    return 0;
+}
+
+/**
+ * @brief Indique si blocks[b] figure déjà parmi blocks[0] à blocks[b-1].
+ * 
+ * La racine d'origine, initialisée sans allocate_inode, a ses pointeurs
+ * inutilisés à 0 et non à -1: ils désignent tous le même bloc.
+ */
+static int baseline_repeats(const int *blocks, int b) {
+    for (int k = 0; k < b; k++) {
+        if (blocks[k] == blocks[b]) return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Lit un fichier du format d'origine et le convertit dans la disposition actuelle.
+ * 
+ * La partition obtenue garde la taille de bloc et le nombre d'inodes d'origine;
+ * elle a juste assez de blocs pour que les blocs de données gardent leurs
+ * numéros, si bien que les pointeurs des inodes sont repris tels quels. Le
+ * bitmap des blocs est recalculé d'après les blocs réellement désignés par les
+ * inodes (celui du fichier n'est pas fiable: le bloc du répertoire racine n'y
+ * était pas marqué). Les répertoires restent au format dir_entry_fixed_t:
+ * load_partition les convertit ensuite (le superbloc garde
+ * PARTITION_MAGIC_BASELINE d'ici là).
+ * 
+ * @param file Fichier positionne apres les dix premiers champs du superbloc.
+ * @param sb Ces champs.
+ * @return L'espace converti, ou NULL en cas d'erreur (un message est affiche).
+ */
+static espace_utilisable_t* read_baseline_space(FILE *file, const superblock_t *sb) {
+    if (sb->block_size != BASELINE_BLOCK_SIZE || sb->num_blocks != BASELINE_NUM_BLOCKS ||
+        sb->num_inodes != BASELINE_NUM_INODES || sb->first_data_block != BASELINE_FIRST_DATA_BLOCK ||
+        sb->inode_size != (int)sizeof(inode_baseline_t)) {
+        printf("Erreur: Disposition de la partition incompatible\n");
+        return NULL;
+    }
+    
+    // Le bitmap des blocs du fichier n'est pas relu: il est recalculé plus bas
+    unsigned char inode_bitmap[BASELINE_INODE_BITMAP_BYTES];
+    inode_baseline_t old_inodes[BASELINE_NUM_INODES];
+    size_t old_size = (size_t)BASELINE_NUM_BLOCKS * BASELINE_BLOCK_SIZE;
+    char *old_data = (char*)malloc(old_size);
+    if (old_data == NULL) {
+        printf("Erreur: Impossible d'allouer de la memoire pour la partition\n");
+        return NULL;
+    }
+    if (fseek(file, BASELINE_BLOCK_BITMAP_BYTES, SEEK_CUR) != 0 ||
+        fread(inode_bitmap, sizeof(inode_bitmap), 1, file) != 1 ||
+        fread(old_inodes, sizeof(old_inodes), 1, file) != 1 ||
+        fread(old_data, sizeof(char), old_size, file) != old_size) {
+        printf("Erreur: Lecture des donnees de la partition echouee\n");
+        free(old_data);
+        return NULL;
+    }
+    
+    // Même taille de bloc et même nombre d'inodes, autant de blocs de données
+    int data_blocks = BASELINE_NUM_BLOCKS - BASELINE_FIRST_DATA_BLOCK;
+    partition_geometry_t geom = { BASELINE_BLOCK_SIZE, BASELINE_NUM_BLOCKS, BASELINE_NUM_INODES };
+    superblock_t layout;
+    compute_layout(&geom, &layout);
+    geom.num_blocks = layout.first_data_block + data_blocks;
+    
+    espace_utilisable_t *space = allocate_space((size_t)geom.num_blocks * geom.block_size);
+    if (space == NULL) {
+        printf("Erreur: Impossible d'allouer de la memoire pour la partition\n");
+        free(old_data);
+        return NULL;
+    }
+    partition_t conv;
+    memset(&conv, 0, sizeof(conv));
+    conv.space = space;
+    compute_layout(&geom, (superblock_t*)(space->data + SUPERBLOCK_OFSET));
+    setup_partition_layout(&conv);
+    conv.superblock->magic = PARTITION_MAGIC_BASELINE;
+    conv.superblock->blocks_per_group = conv.num_blocks;
+    conv.superblock->inodes_per_group = conv.num_inodes;
+    conv.superblock->free_blocks_count = data_blocks;
+    conv.superblock->free_inodes_count = conv.num_inodes;
+    
+    // Les blocs de données gardent leurs numéros
+    memcpy(block_ptr(&conv, 0), old_data + (size_t)BASELINE_FIRST_DATA_BLOCK * BASELINE_BLOCK_SIZE,
+           (size_t)data_blocks * BASELINE_BLOCK_SIZE);
+    
+    // Métadonnées et bits au-delà de la fin marqués utilisés, comme à l'initialisation
+    for (int i = 0; i < conv.first_data_block; i++) {
+        conv.block_bitmap[i / BITMAP_WORD_BITS] |= 1ULL << (i % BITMAP_WORD_BITS);
+    }
+    for (int i = conv.num_blocks; i < BITMAP_WORDS(conv.num_blocks) * BITMAP_WORD_BITS; i++) {
+        conv.block_bitmap[i / BITMAP_WORD_BITS] |= 1ULL << (i % BITMAP_WORD_BITS);
+    }
+    for (int i = conv.num_inodes; i < BITMAP_WORDS(conv.num_inodes) * BITMAP_WORD_BITS; i++) {
+        conv.inode_bitmap[i / BITMAP_WORD_BITS] |= 1ULL << (i % BITMAP_WORD_BITS);
+    }
+    
+    // Les fichiers d'abord: un bloc de répertoire que la version d'origine a
+    // redonné à un fichier (et effacé) reste au fichier
+    int dropped = 0;
+    for (int pass = 0; pass < 2; pass++) {
+        for (int i = 0; i < BASELINE_NUM_INODES; i++) {
+            inode_baseline_t *old = &old_inodes[i];
+            if (!(inode_bitmap[i / 8] & (1 << (i % 8))) || old->mode == 0) continue;
+            int type = old->mode & 0170000;
+            if (type != 040000 && type != 0100000 && type != 0120000) continue;  // Inode écrasé
+            int is_dir = type == 040000;
+            if (is_dir != pass) continue;
+            
+            inode_t *inode = &conv.inodes[i];
+            inode->mode = old->mode;
+            inode->uid = old->uid;
+            inode->gid = old->gid;
+            inode->size = old->size;
+            inode->atime = old->atime;
+            inode->mtime = old->mtime;
+            inode->ctime = old->ctime;
+            inode->links_count = old->links_count;
+            inode->dir_index_block = -1;
+            clear_block_map(inode);
+            
+            // Un bloc inexistant ou déjà pris est ignoré (il se lit comme un trou);
+            // les blocs d'un répertoire sont mis à la suite (dir_blocks)
+            int n = 0;
+            for (int b = 0; b < NUM_DIRECT_BLOCKS; b++) {
+                if (old->direct_blocks[b] == -1 || baseline_repeats(old->direct_blocks, b)) continue;
+                if (baseline_claim_block(&conv, old->direct_blocks[b]) != 0) {
+                    dropped++;
+                    continue;
+                }
+                inode->direct_blocks[is_dir ? n : b] = old->direct_blocks[b];
+                n++;
+            }
+            if (is_dir) {
+                // Les répertoires n'avaient pas de bloc indirect utilisable
+                inode->dir_blocks = n;
+            } else if (old->indirect_block != -1) {
+                if (baseline_claim_block(&conv, old->indirect_block) != 0) {
+                    dropped++;
+                } else {
+                    int *table = (int*)block_ptr(&conv, old->indirect_block);
+                    for (int k = 0; k < BASELINE_BLOCK_SIZE / (int)sizeof(int); k++) {
+                        if (table[k] != -1 && baseline_claim_block(&conv, table[k]) != 0) {
+                            table[k] = -1;
+                            dropped++;
+                        }
+                    }
+                    inode->indirect_block = old->indirect_block;
+                }
+            }
+            
+            conv.inode_bitmap[i / BITMAP_WORD_BITS] |= 1ULL << (i % BITMAP_WORD_BITS);
+            conv.superblock->free_inodes_count--;
+        }
+    }
+    if (dropped > 0) {
+        printf("Avertissement: %d blocs inexistants ou partages ignores dans la partition d'origine\n", dropped);
+    }
+    free(old_data);
+    return space;
+}
+
 /**
  * @brief Charge l'état d'une partition depuis un fichier.
  * 
+ * La geometrie (taille de bloc, nombre de blocs et d'inodes) est lue dans le
+ * superbloc du fichier; l'espace de la partition est realloue en consequence.
+ * Un fichier du format d'origine (PARTITION_MAGIC_BASELINE, disposition fixe)
+ * est converti: voir read_baseline_space, puis ses repertoires passent aux
+ * entrees de longueur variable.
+ * La partition n'est modifiee que si le chargement complet a reussi.
+ * 
  * @param part Pointeur vers la partition à remplir.
  * @param filename Nom du fichier contenant la partition sauvegardée.
  * @return 0 en cas de succès, -1 en cas d'erreur.
@@ -63,95 +304,111 @@ int load_partition(partition_t *part, const char *filename) {
         return -1;
     }
     
-    // Vérifier si la partition a déjà été allouée
-    if (part->space == NULL) {
-        // Si non, allouer l'espace pour la partition
-        part->space = (espace_utilisable_t*)malloc(sizeof(espace_utilisable_t));
-        if (part->space == NULL) {
-            printf("Erreur: Impossible d'allouer de la memoire pour la partition\n");
-            fclose(file);
-            return -1;
-        }
-        memset(part->space, 0, sizeof(espace_utilisable_t));
-    }
-    
-    // Allouer temporairement la mémoire pour le superblock
-    superblock_t *temp_superblock = (superblock_t*)malloc(sizeof(superblock_t));
-    if (temp_superblock == NULL) {
-        printf("Erreur: Allocation memoire echouee\n");
-        fclose(file);
-        return -1;
-    }
-    
-    // Lire le superblock
-    if (fread(temp_superblock, sizeof(superblock_t), 1, file) != 1) {
+    // Lire le superblock: d'abord la partie commune à tous les formats
+    superblock_t sb;
+    if (fread(&sb, offsetof(superblock_t, block_bitmap_block), 1, file) != 1) {
         printf("Erreur: Lecture du superblock echouee\n");
-        free(temp_superblock);
         fclose(file);
         return -1;
     }
     
     // Vérifier le numero magique pour s'assurer qu'il s'agit d'un fichier de partition valide
-    if (temp_superblock->magic != 0x12345678) {
+    espace_utilisable_t *space;
+    if (sb.magic == PARTITION_MAGIC_BASELINE) {
+        space = read_baseline_space(file, &sb);
+    } else if (sb.magic == PARTITION_MAGIC || sb.magic == PARTITION_MAGIC_NO_ORPHANS) {
+        space = read_space(file, &sb);
+    } else {
         printf("Erreur: Format de fichier de partition invalide\n");
-        free(temp_superblock);
+        space = NULL;
+    }
+    if (space == NULL) {
         fclose(file);
         return -1;
     }
     
-    // Maintenant, initialiser les pointeurs dans part->space->data
-    part->superblock = (superblock_t*)(part->space->data + SUPERBLOCK_OFSET * BLOCK_SIZE);
-    part->block_bitmap = (block_bitmap_t*)(part->space->data + BLOCKB_OFSET * BLOCK_SIZE);
-    part->inode_bitmap = (inode_bitmap_t*)(part->space->data + INODEB_OFSET * BLOCK_SIZE);
-    part->inodes = (inode_t*)(part->space->data + INODE_OFSET * BLOCK_SIZE);
-    
-    // Copier les donnees du superblock temporaire
-    memcpy(part->superblock, temp_superblock, sizeof(superblock_t));
-    free(temp_superblock);
-    
-    // Lire la bitmap des blocs
-    if (fread(part->block_bitmap, sizeof(block_bitmap_t), 1, file) != 1) {
-        printf("Erreur: Lecture de la bitmap des blocs echouee\n");
+    // Lire l'inode du repertoire courant et l'utilisateur courant
+    int current_dir_inode;
+    user_t current_user;
+    if (fread(&current_dir_inode, sizeof(int), 1, file) != 1) {
+        printf("Erreur: Lecture de l'inode du repertoire courant echouee\n");
+        free(space);
         fclose(file);
         return -1;
     }
-    
-    // Lire la bitmap des inodes
-    if (fread(part->inode_bitmap, sizeof(inode_bitmap_t), 1, file) != 1) {
-        printf("Erreur: Lecture de la bitmap des inodes echouee\n");
+    if (fread(&current_user, sizeof(user_t), 1, file) != 1) {
+        printf("Erreur: Lecture des informations de l'utilisateur courant echouee\n");
+        free(space);
         fclose(file);
         return -1;
     }
+    fclose(file);
     
-    // Lire la table d'inodes
-    if (fread(part->inodes, sizeof(inode_t), MAX_INODES, file) != MAX_INODES) {
-        printf("Erreur: Lecture de la table d'inodes echouee\n");
-        fclose(file);
-        return -1;
+    // Preparer la nouvelle partition à part: l'ancienne reste intacte tant
+    // que la conversion et l'allocation des caches peuvent echouer
+    partition_t staged = *part;
+    staged.space = space;
+    setup_partition_layout(&staged);
+    
+    // Le summary des inodes est derive du bitmap: le recalculer garantit sa coherence
+    rebuild_inode_summary(&staged);
+    
+    // Le curseur next-fit n'est pas sauvegarde: repartir du debut de l'espace utilisateur
+    staged.next_free_block = staged.first_data_block;
+    
+    // Format d'origine: réécrire chaque répertoire en entrées de longueur variable
+    if (sb.magic == PARTITION_MAGIC_BASELINE) {
+        for (int i = 0; i < staged.num_inodes; i++) {
+            int used = (staged.inode_bitmap[i / BITMAP_WORD_BITS] >> (i % BITMAP_WORD_BITS)) & 1;
+            if (used && (staged.inodes[i].mode & 0170000) == 040000 && dir_convert_fixed(&staged, i) != 0) {
+                printf("Erreur: Conversion du repertoire (inode %d) echouee\n", i);
+                free(space);
+                return -1;
+            }
+        }
+        // Le répertoire courant a pu être écrasé dans la partition d'origine
+        if (current_dir_inode < 0 || current_dir_inode >= staged.num_inodes ||
+            (staged.inodes[current_dir_inode].mode & 0170000) != 040000) {
+            current_dir_inode = 0;
+        }
     }
+    // Les formats précédents n'avaient pas d'orphelins: le reste du bloc 0 est nul
+    staged.superblock->magic = PARTITION_MAGIC;
     
-    // Lire les donnees de l'espace utilisable
-    if (fread(part->space->data, sizeof(char), PARTITION_SIZE, file) != PARTITION_SIZE) {
-        printf("Erreur: Lecture des donnees de la partition echouee\n");
-        fclose(file);
+    // Caches dimensionnés pour la nouvelle partition (dont le nombre d'inodes peut différer)
+    if (dcache_init(&staged) != 0) {
+        printf("Erreur: Impossible d'allouer de la memoire pour le cache des noms\n");
+        free(space);
         return -1;
     }
     
-    // Lire l'inode du repertoire courant
-    if (fread(&part->current_dir_inode, sizeof(int), 1, file) != 1) {
-        printf("Erreur: Lecture de l'inode du repertoire courant echouee\n");
-        fclose(file);
-        return -1;
+    // Tout a reussi: remplacer l'espace et les caches, repositionner les pointeurs
+    dcache_destroy(part);
+    free(part->space);
+    part->space = space;
+    setup_partition_layout(part);
+    part->next_free_block = staged.next_free_block;
+    part->dcache = staged.dcache;
+    part->dir_parents = staged.dir_parents;
+    part->symlinks = staged.symlinks;
+    part->dir_index_retry = staged.dir_index_retry;
+    part->map_generation = staged.map_generation;
+    part->current_dir_inode = current_dir_inode;
+    part->current_user = current_user;
+    
+    // Les descripteurs et les parcours désignent des inodes de l'ancienne partition
+    file_close_all(part);
+    for (dir_stream_t *stream = part->dir_streams; stream != NULL; stream = stream->next) {
+        stream->dir_inode = -1;
     }
     
-    // Lire les informations de l'utilisateur courant
-    if (fread(&part->current_user, sizeof(user_t), 1, file) != 1) {
-        printf("Erreur: Lecture des informations de l'utilisateur courant echouee\n");
-        fclose(file);
-        return -1;
+    // Terminer une suppression différée interrompue par la sauvegarde
+    part->reclaim_depth = 0;
+    if (part->superblock->orphan_count > 0) {
+        int reclaimed = reclaim_orphans(part, INT_MAX);
+        printf("%d entrees supprimees en differe recuperees\n", reclaimed);
     }
     
-    fclose(file);
     printf("Partition chargee avec succès depuis '%s'\n", filename);
     return 0;
 }
@@ -159,28 +416,43 @@ int load_partition(partition_t *part, const char *filename) {
 /**
  * @brief Cree et initialise une nouvelle partition.
  * 
+ * @param geom Geometrie de la partition, ou NULL pour la geometrie par defaut
+ *        (DEFAULT_BLOCK_SIZE, DEFAULT_NUM_BLOCKS, DEFAULT_NUM_INODES).
  * @return Pointeur vers la nouvelle partition allouee, ou NULL en cas d'echec.
  */
-partition_t* create_new_partition() {
-    partition_t *part = (partition_t*)malloc(sizeof(partition_t));
+partition_t* create_new_partition(const partition_geometry_t *geom) {
+    partition_geometry_t default_geom = { DEFAULT_BLOCK_SIZE, DEFAULT_NUM_BLOCKS, DEFAULT_NUM_INODES };
+    if (geom == NULL) {
+        geom = &default_geom;
+    }
+    if (validate_geometry(geom) != 0) {
+        return NULL;
+    }
+    
+    partition_t *part = (partition_t*)calloc(1, sizeof(partition_t));
     if (part == NULL) {
         printf("Erreur: Impossible d'allouer de la memoire pour la partition\n");
         return NULL;
     }
     
-    // Allouer l'espace utilisable
-    part->space = (espace_utilisable_t*)malloc(sizeof(espace_utilisable_t));
+    // Allouer l'espace utilisable (initialise à zero)
+    part->space = allocate_space((size_t)geom->num_blocks * geom->block_size);
     if (part->space == NULL) {
         printf("Erreur: Impossible d'allouer de la memoire pour l'espace utilisable\n");
         free(part);
         return NULL;
     }
     
-    // Initialiser à zero
-    memset(part->space, 0, sizeof(espace_utilisable_t));
-    
     // Initialiser la partition
-    init_partition(part);
+    init_partition(part, geom);
+    
+    // Cache des noms, vide au départ
+    if (dcache_init(part) != 0) {
+        printf("Erreur: Impossible d'allouer de la memoire pour le cache des noms\n");
+        free(part->space);
+        free(part);
+        return NULL;
+    }
     
     return part;
 }
@@ -195,6 +467,8 @@ void free_partition(partition_t *part) {
         if (part->space != NULL) {
             free(part->space);
         }
+        dcache_destroy(part);
+        free(part->reclaim_stack);
         free(part);
     }
 }
@@ -6,12 +6,13 @@
 #include <time.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <stddef.h>
 #include "structure.h"
 #include "init.h"
 extern partition_t *global_partition;
 void sigint_handler(int sig);
 void free_partition(partition_t *part);
-partition_t* create_new_partition();
+partition_t* create_new_partition(const partition_geometry_t *geom);
 int load_partition(partition_t *part, const char *filename);
 int save_partition(partition_t *part, const char *filename);
 #endif // LOAD_H
\ No newline at end of file
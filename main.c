@@ -19,10 +19,12 @@
 #include "folder_operation.h"
 #include "block.h"
 #include "file_operation.h"
+#include "file_table.h"
 #include "init.h"
 #include "inode.h"
 #include "load.h"
 #include "permission.h"
+#include "dir_btree.h"
 
 
 
@@ -64,49 +66,33 @@ void setup_signal_handler(partition_t *part) {
 
 int main(int argc, char *argv[]) {
 
-    
-
-    espace_utilisable_t *space = (espace_utilisable_t *)malloc(sizeof(espace_utilisable_t));
-    if (!space) {
-        printf("Erreur d'allocation memoire\n");
-        return 1;
+    // Geometrie de la partition, modifiable par -b (taille de bloc),
+    // -n (nombre de blocs) et -i (nombre d'inodes)
+    partition_geometry_t geometry = { DEFAULT_BLOCK_SIZE, DEFAULT_NUM_BLOCKS, DEFAULT_NUM_INODES };
+    int opt;
+    while ((opt = getopt(argc, argv, "b:n:i:")) != -1) {
+        switch (opt) {
+            case 'b': geometry.block_size = atoi(optarg); break;
+            case 'n': geometry.num_blocks = atoi(optarg); break;
+            case 'i': geometry.num_inodes = atoi(optarg); break;
+            default:
+                printf("Usage: %s [-b taille_bloc] [-n nb_blocs] [-i nb_inodes] [fichier_commandes]\n", argv[0]);
+                return 1;
+        }
     }
-    
-    // Allouer de la memoire pour la structure partition separement
-    partition_t *partition = (partition_t *)malloc(sizeof(partition_t));
+
+    // Allouer et initialiser la partition
+    partition_t *partition = create_new_partition(&geometry);
     if (!partition) {
         printf("Erreur d'allocation memoire pour partition\n");
-        free(space);
         return 1;
     }
 
-    
-    // Definir la relation entre partition et space
-    partition->space = space;
-    
-    // Initialiser les pointeurs vers les zones dans part->space->data
-    partition->superblock = (superblock_t*)(partition->space->data + SUPERBLOCK_OFSET * BLOCK_SIZE);
-
-    partition->superblock->block_size=5;
-    
-    // Initialiser le bitmap des blocs
-    block_bitmap_t* test = (block_bitmap_t*)(partition->space->data + BLOCKB_OFSET* BLOCK_SIZE );
-    
-
-
-    partition->block_bitmap=test;
-
-
-    partition->block_bitmap->bitmap[4]=0xFF;
-
-    // Initialiser la partition
-    init_partition(partition);
-
     setup_signal_handler(partition);
     
-    char command[256];
-    char param1[MAX_NAME_LENGTH];
-    char param2[MAX_NAME_LENGTH];
+    char command[MAX_NAME_LENGTH * 4];
+    char param1[MAX_NAME_LENGTH * 4];
+    char param2[MAX_NAME_LENGTH * 4];
     int running = 1;
     
     printf("Systeme de fichiers initialise. Tapez 'help' pour voir les commandes disponibles.\n");
@@ -114,12 +100,11 @@ int main(int argc, char *argv[]) {
     create_file(partition,"root",040777);
     change_directory(partition,"root");
     FILE *input = stdin;
-    if (argc > 1) {
-        input = fopen(argv[1], "r");
+    if (optind < argc) {
+        input = fopen(argv[optind], "r");
         if (!input) {
             perror("Erreur lors de l'ouverture du fichier de commandes");
-            free(space);
-            free(partition);
+            free_partition(partition);
             return 1;
         }
     }
@@ -161,13 +146,21 @@ int main(int argc, char *argv[]) {
             printf("Commandes disponibles:\n");
             printf("  help          - Affiche cette aide\n");
             printf("  ls            - Liste le contenu du repertoire courant\n");
+            printf("  ls -R -n -S -t - Liste recursivement, trie par nom, taille ou date\n");
+            printf("  ls debut*     - Liste les entrees dont le nom commence par debut\n");
+            printf("  ls rep/debut* - Idem dans le repertoire rep\n");
             printf("  mkdir nom     - Cree un repertoire\n");
+            printf("  mkdir -b nom  - Cree un repertoire trie par nom (B-arbre)\n");
             printf("  touch nom     - Cree un fichier vide\n");
             printf("  cd nom        - Change de repertoire\n");
             printf("  rm nom        - Supprime un fichier ou repertoire\n");
             printf("  rm -r nom     - Supprime un fichier ou repertoire\n");
+            printf("  rm -rb nom    - Supprime un repertoire, son contenu est libere en arriere-plan\n");
 	    printf("  ln src dest   -Creer un lien simbolique");
             printf("  ln -s src dst - Cree un lien symbolique\n");
+            printf("  cat nom       - Affiche le contenu d'un fichier\n");
+            printf("  cat > nom     - Remplace le contenu d'un fichier (fin: . sur une ligne)\n");
+            printf("  cat >> nom    - Ajoute a la fin d'un fichier (fin: . sur une ligne)\n");
             printf("  chmod mode nom- Change les permissions d'un fichier (mode en octal)\n");
             printf("  chown uid:gid nom - Change le proprietaire d'un fichier\n");
             printf("  su uid gid    - Change d'utilisateur\n");
@@ -178,13 +171,40 @@ int main(int argc, char *argv[]) {
             printf("  load fichier  - load la partition a partir d'un fichier\n");
             printf("  exit          - Quitte le programme\n");
         } else if (strncmp(command, "ls", 2) == 0) {
-            if (sscanf(command + 2, "%s", param1) == 1) {
-                list_directory(partition, param1); // Executer avec l'argument s'il existe
-            } else {
-                list_directory(partition, NULL); // Sinon, executer sans argument
+            // Options (-R, -n, -S, -t, combinables) puis nom eventuel
+            int ls_flags = 0, ls_ok = 1;
+            char *ls_name = NULL;
+            for (char *arg = strtok(command + 2, " \t"); arg != NULL; arg = strtok(NULL, " \t")) {
+                if (arg[0] != '-') {
+                    strcpy(param1, arg);
+                    ls_name = param1;
+                    continue;
+                }
+                for (char *o = arg + 1; *o != '\0'; o++) {
+                    switch (*o) {
+                        case 'R': ls_flags |= LS_RECURSIVE; break;
+                        case 'n': ls_flags |= LS_SORT_NAME; break;
+                        case 'S': ls_flags |= LS_SORT_SIZE; break;
+                        case 't': ls_flags |= LS_SORT_TIME; break;
+                        default:
+                            printf("Erreur: Option de ls inconnue '-%c'\n", *o);
+                            ls_ok = 0;
+                    }
+                }
+            }
+            if (ls_ok) {
+                list_directory(partition, ls_name, ls_flags); // Sans nom: tout le repertoire
             }
             printf("\n");
         }
+        else if (strncmp(command, "mkdir -b ", 9) == 0) {
+            // Repertoire trie: entrees indexees par un B-arbre ordonne par nom
+            sscanf(command + 9, "%s", param1);
+            int dir = create_file(partition, param1, 040755);
+            if (dir != -1) {
+                dir_btree_create(partition, dir);
+            }
+        }
         else if (strncmp(command, "mkdir ", 6) == 0) {
             sscanf(command + 6, "%s", param1);
             create_file(partition, param1, 040755);  // drwxr-xr-x
@@ -196,6 +216,9 @@ int main(int argc, char *argv[]) {
         else if (strncmp(command, "cd ", 3) == 0) {
             sscanf(command + 3, "%s", param1);
             change_directory(partition, param1);
+        }else if(strncmp(command, "rm -rb ", 7) == 0){
+            sscanf(command + 7, "%s", param1);
+            delete_deferred(partition,param1);
         }else if(strncmp(command, "rm -r  ", 5) == 0){
             sscanf(command + 5, "%s", param1);
             delete_recursive(partition,param1);
@@ -235,10 +258,13 @@ int main(int argc, char *argv[]) {
             sscanf(command + 3, "%s %s", param1, param2);
             move_file_with_paths(partition, param1, param2,MOVMODE);
  
-        }else if(strncmp(command, "cat > ",6 ) == 0){
+        }else if(strncmp(command, "cat > ",6 ) == 0 || strncmp(command, "cat >> ",7 ) == 0){
+    // "cat >>" ajoute à la fin du fichier au lieu de le remplacer
+    int append = command[5] == '>';
+    
     // Extraire le nom du fichier en preservant les espaces eventuels
     char filename[MAX_NAME_LENGTH];
-    int i = 6;  // Position après "cat > "
+    int i = append ? 7 : 6;  // Position après "cat > " ou "cat >> "
     int j = 0;
     
     // Ignorer les espaces initiaux
@@ -253,35 +279,36 @@ int main(int argc, char *argv[]) {
     if(strlen(filename) == 0) {
         printf("Erreur: Nom de fichier requis\n");
     } else {
-        // Allouer un buffer pour stocker le contenu
-        char *content = malloc(BLOCK_SIZE * NUM_DIRECT_BLOCKS);  // Taille maximale possible
-        if(!content) {
-            printf("Erreur: Memoire insuffisante\n");
-        } else {
-            content[0] = '\0';  // Initialiser la chaîne vide
-            
-            printf("Entrez le contenu du fichier (terminez par un . sur une ligne vide):\n");
-            
-            char buffer[1024];
-            while(fgets(buffer, sizeof(buffer), input) != NULL) {
-                // Verifier si la saisie est terminee par un signal special
-                if(strcmp(buffer, ".\n") == 0) break;  // Une ligne contenant seulement un point termine la saisie
-                
-                // Ajouter la ligne au contenu
-                if(strlen(content) + strlen(buffer) < BLOCK_SIZE * NUM_DIRECT_BLOCKS) {
-                    strcat(content, buffer);
-                } else {
-                    printf("Avertissement: Taille maximale du fichier atteinte\n");
-                    break;
-                }
-            }
-            
-            // ecrire le contenu dans le fichier
-            if(cat_write_command(partition, filename, content) != 0) {
-                printf("Erreur: Echec d'ecriture dans le fichier '%s'\n", filename); 
-            }
+        printf("Entrez le contenu du fichier (terminez par un . sur une ligne vide):\n");
+        
+        // Chaque ligne est ecrite dans le fichier des qu'elle est lue, a la
+        // position du descripteur: ni copie de tout le contenu, ni taille maximale.
+        // getline donne la longueur lue: une ligne peut contenir des '\0'.
+        int fd = file_open(partition, filename, OPEN_WRITE | OPEN_CREATE | (append ? OPEN_APPEND : OPEN_TRUNC));
+        int error = fd < 0 ? fd : 0;
+        int total = 0;
+        char *line = NULL;
+        size_t line_cap = 0;
+        ssize_t len;
+        while((len = getline(&line, &line_cap, input)) != -1) {
+            // Une ligne contenant seulement un point termine la saisie
+            if(len == 2 && line[0] == '.' && line[1] == '\n') break;
             
-            free(content);
+            // Apres une erreur, lire quand meme jusqu'au point pour ne pas
+            // executer le contenu comme des commandes
+            if(error != 0) continue;
+            int written = file_write(partition, fd, line, len);
+            if(written > 0) total += written;  // Une ecriture courte a deja place ces octets
+            if(written != len) error = -1;
+        }
+        free(line);
+        if(fd >= 0) file_close(partition, fd);
+        
+        // Comme cat, rien n'est affiche en cas de succes
+        if(error == -2) {
+            printf("Erreur: permission refusee pour '%s'.\n", filename);
+        } else if(error != 0) {
+            printf("Erreur: Echec d'ecriture dans le fichier '%s' (%d octets ecrits).\n", filename, total);
         }
     }
 
@@ -302,10 +329,13 @@ int main(int argc, char *argv[]) {
         else {
             printf("Commande inconnue. Tapez 'help' pour voir les commandes disponibles.\n");
         }
+        
+        // Liberer un morceau des repertoires supprimes en differe avant la commande suivante
+        reclaim_orphans(partition, ORPHAN_RECLAIM_BUDGET);
     }
     
     // Liberer la memoire
-    free(space);  // Liberer l'espace utilisable plutôt que partition
+    free_partition(partition);
     if (input != stdin) {
         fclose(input);
     }
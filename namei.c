@@ -0,0 +1,184 @@
+/**
+ * @file namei.c
+ * @brief Résolution des chemins, commune à toutes les commandes.
+ *
+ * namei parcourt un chemin absolu ou relatif en une seule passe, composant
+ * par composant, directement dans la chaîne (sans la découper au préalable).
+ * Chaque répertoire traversé doit être cherchable (droit x), les liens
+ * symboliques rencontrés en route sont suivis (leur cible est résolue depuis
+ * le répertoire qui contient le lien) et "." et ".." sont interprétés au vol.
+ *
+ * La cible résolue d'un lien est gardée en cache (voir symlink_cache_lookup):
+ * un lien déjà traversé ne coûte plus qu'une comparaison de génération. Une
+ * boucle est détectée dès qu'un lien réapparaît dans sa propre résolution.
+ * Avec NAMEI_PARENT, le dernier composant peut ne pas exister: l'appelant
+ * reçoit alors son répertoire et son nom, pour le créer.
+ */
+
+#include "namei.h"
+
+
+static int walk(partition_t *part, int start_dir, const char *path, int flags, namei_links_t *links, nameidata_t *nd);
+
+
+/**
+ * @brief Résout la cible d'un lien symbolique depuis le répertoire du lien.
+ *
+ * @param dir Répertoire qui contient le lien.
+ * @param link_inode Inode du lien.
+ * @param links Liens suivis et pile des liens en cours de résolution.
+ * @param target Reçoit l'inode désigné par la cible.
+ * @return 0 en cas de succès, une erreur NAMEI_E* sinon.
+ */
+static int follow_link(partition_t *part, int dir, int link_inode, namei_links_t *links, int *target) {
+    // Un lien déjà en cours de résolution: la cible mène à elle-même
+    for (int i = 0; i < links->depth; i++) {
+        if (links->stack[i] == link_inode) return NAMEI_ELOOP;
+    }
+    if (links->count >= NAMEI_MAX_SYMLINKS) return NAMEI_ELOOP;
+
+    const char *path = symlink_target(part, link_inode);
+    if (path == NULL || path[0] == '\0') return NAMEI_ENOENT;
+
+    links->count++;
+    links->stack[links->depth++] = link_inode;
+    nameidata_t nd;
+    int error = walk(part, dir, path, NAMEI_FOLLOW, links, &nd);
+    links->depth--;
+    if (error != 0) return error;
+
+    *target = nd.inode;
+    return 0;
+}
+
+
+/**
+ * @brief Parcourt un chemin depuis start_dir (ou la racine s'il est absolu).
+ *
+ * @param links Liens symboliques déjà suivis et liens en cours de résolution.
+ */
+static int walk(partition_t *part, int start_dir, const char *path, int flags, namei_links_t *links, nameidata_t *nd) {
+    int cur = path[0] == '/' ? 1 : start_dir;
+    const char *p = path;
+
+    nd->inode = cur;
+    nd->parent = cur;
+    nd->name[0] = '\0';
+
+    while (1) {
+        while (*p == '/') p++;
+        if (*p == '\0') break;
+
+        size_t len = strcspn(p, "/");
+        const char *next = p + len;
+        while (*next == '/') next++;
+        int last = *next == '\0';
+
+        // Le répertoire courant du parcours doit être un répertoire cherchable
+        if ((part->inodes[cur].mode & 0170000) != 040000) return NAMEI_ENOTDIR;
+        if (!check_permission(part, cur, 1)) return NAMEI_EACCES;
+        if (len >= MAX_NAME_LENGTH) return NAMEI_ENAMETOOLONG;
+
+        memcpy(nd->name, p, len);
+        nd->name[len] = '\0';
+        nd->parent = cur;
+
+        int inode_num;
+        if (len == 1 && p[0] == '.') {
+            inode_num = cur;
+        } else {
+            inode_num = find_file_in_dir(part, cur, nd->name);
+            // Le ".." de la racine désigne l'inode caché 0: la racine est son propre parent
+            if (inode_num == -1 && len == 2 && p[0] == '.' && p[1] == '.') inode_num = cur;
+        }
+        if (inode_num == -1) {
+            if (last && (flags & NAMEI_PARENT)) {
+                nd->inode = -1;
+                return 0;
+            }
+            return NAMEI_ENOENT;
+        }
+
+        // Lien symbolique: suivi en route, et en dernier composant avec NAMEI_FOLLOW
+        if ((part->inodes[inode_num].mode & 0170000) == 0120000 && (!last || (flags & NAMEI_FOLLOW))) {
+            int link_inode = inode_num;
+            if (!symlink_cache_lookup(part, link_inode, cur, &inode_num)) {
+                int error = follow_link(part, cur, link_inode, links, &inode_num);
+                if (error != 0) return error;
+                symlink_cache_insert(part, link_inode, cur, inode_num);
+            }
+        }
+
+        nd->inode = inode_num;
+        cur = inode_num;
+        p = next;
+    }
+
+    // "nom/" désigne forcément un répertoire
+    size_t path_len = strlen(path);
+    if (path_len > 0 && path[path_len - 1] == '/' && nd->inode != -1 &&
+        (part->inodes[nd->inode].mode & 0170000) != 040000) {
+        return NAMEI_ENOTDIR;
+    }
+    return 0;
+}
+
+
+/**
+ * @brief Résout un chemin depuis un répertoire donné.
+ *
+ * @param part Pointeur vers la partition.
+ * @param start_dir Répertoire de départ d'un chemin relatif.
+ * @param path Chemin absolu ou relatif.
+ * @param flags NAMEI_FOLLOW et/ou NAMEI_PARENT.
+ * @param nd Reçoit l'inode désigné, son répertoire et le dernier composant.
+ * @return 0 en cas de succès, une erreur NAMEI_E* sinon.
+ */
+int namei_at(partition_t *part, int start_dir, const char *path, int flags, nameidata_t *nd) {
+    if (path == NULL || path[0] == '\0') return NAMEI_ENOENT;
+    namei_links_t links = { 0, 0, { 0 } };
+    return walk(part, start_dir, path, flags, &links, nd);
+}
+
+
+/**
+ * @brief Résout un chemin depuis le répertoire courant.
+ *
+ * @param part Pointeur vers la partition.
+ * @param path Chemin absolu ou relatif.
+ * @param flags NAMEI_FOLLOW pour suivre un lien en dernier composant,
+ *              NAMEI_PARENT pour accepter un dernier composant absent.
+ * @param nd Reçoit l'inode désigné (-1 s'il est absent avec NAMEI_PARENT),
+ *           le répertoire qui le contient et son nom.
+ * @return 0 en cas de succès, une erreur NAMEI_E* sinon.
+ */
+int namei(partition_t *part, const char *path, int flags, nameidata_t *nd) {
+    return namei_at(part, part->current_dir_inode, path, flags, nd);
+}
+
+
+/**
+ * @brief Affiche le message d'une erreur de namei.
+ *
+ * @param error Erreur NAMEI_E*.
+ * @param path Chemin concerné.
+ */
+void namei_perror(int error, const char *path) {
+    switch (error) {
+        case NAMEI_ENOENT:
+            printf("Erreur: '%s' non trouve\n", path);
+            break;
+        case NAMEI_ENOTDIR:
+            printf("Erreur: Un composant de '%s' n'est pas un repertoire\n", path);
+            break;
+        case NAMEI_EACCES:
+            printf("Erreur: Permissions insuffisantes pour acceder à '%s'\n", path);
+            break;
+        case NAMEI_ELOOP:
+            printf("Erreur: Boucle ou trop de niveaux de liens symboliques dans '%s'\n", path);
+            break;
+        case NAMEI_ENAMETOOLONG:
+            printf("Erreur: Nom trop long dans '%s' (%d octets maximum)\n", path, MAX_NAME_LENGTH - 1);
+            break;
+    }
+}
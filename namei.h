@@ -0,0 +1,14 @@
+#ifndef NAMEI_H
+#define NAMEI_H
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "structure.h"
+#include "inode.h"
+#include "permission.h"
+#include "file_operation.h"
+int namei(partition_t *part, const char *path, int flags, nameidata_t *nd);
+int namei_at(partition_t *part, int start_dir, const char *path, int flags, nameidata_t *nd);
+void namei_perror(int error, const char *path);
+
+#endif // NAMEI_H
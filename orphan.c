@@ -0,0 +1,180 @@
+/**
+ * @file orphan.c
+ * @brief Suppression différée de sous-arbres (rm -rb).
+ *
+ * orphan_add note dans le superbloc la racine d'un sous-arbre déjà détaché de
+ * son parent: la commande rend la main tout de suite. reclaim_orphans libère
+ * ensuite ces sous-arbres par morceaux (main l'appelle entre deux commandes,
+ * load_partition jusqu'au bout).
+ *
+ * La récupération descend dans l'orphelin avec une pile explicite et efface
+ * chaque entrée avant de libérer l'inode qu'elle désignait. L'arbre reste donc
+ * cohérent à tout moment: une partition sauvegardée au milieu d'une
+ * récupération contient un orphelin partiellement vidé, que le chargement
+ * suivant termine. La pile, elle, n'est qu'un curseur en mémoire.
+ */
+
+#include "orphan.h"
+
+
+/**
+ * @brief Empile un répertoire de l'orphelin en cours de récupération.
+ *
+ * @return 0, ou -1 si la mémoire manque.
+ */
+static int reclaim_push(partition_t *part, int dir, int entry_pos) {
+    if (part->reclaim_depth == part->reclaim_capacity) {
+        int new_capacity = part->reclaim_capacity != 0 ? part->reclaim_capacity * 2 : 16;
+        reclaim_frame_t *stack = (reclaim_frame_t *)realloc(part->reclaim_stack, new_capacity * sizeof(reclaim_frame_t));
+        if (stack == NULL) return -1;
+        part->reclaim_stack = stack;
+        part->reclaim_capacity = new_capacity;
+    }
+    reclaim_frame_t *frame = &part->reclaim_stack[part->reclaim_depth++];
+    frame->dir = dir;
+    frame->block = 0;
+    frame->entry_pos = entry_pos;
+    return 0;
+}
+
+
+/**
+ * @brief Retire un orphelin entièrement récupéré de la liste du superbloc.
+ */
+static void orphan_remove(partition_t *part, int dir) {
+    superblock_t *sb = part->superblock;
+    for (int i = 0; i < sb->orphan_count; i++) {
+        if (sb->orphans[i] == dir) {
+            sb->orphans[i] = sb->orphans[--sb->orphan_count];
+            return;
+        }
+    }
+}
+
+
+/**
+ * @brief Ajoute un inode à libérer en fin de morceau; sans mémoire, il est libéré tout de suite.
+ */
+static void freed_push(partition_t *part, int **freed, int *count, int *cap, int inode_num) {
+    if (*count == *cap) {
+        int new_cap = *cap != 0 ? *cap * 2 : 256;
+        int *list = (int *)realloc(*freed, new_cap * sizeof(int));
+        if (list == NULL) {
+            free_inode(part, inode_num);
+            return;
+        }
+        *freed = list;
+        *cap = new_cap;
+    }
+    (*freed)[(*count)++] = inode_num;
+}
+
+
+/**
+ * @brief Récupère un morceau des sous-arbres orphelins.
+ *
+ * Chaque entrée effacée compte pour une unité du budget, chaque répertoire
+ * vidé aussi. Un fichier encore lié hors de l'orphelin perd seulement un lien.
+ * Les inodes libérés pendant le morceau sont rendus en un lot (free_inodes).
+ *
+ * @param part Pointeur vers la partition.
+ * @param budget Nombre d'entrées à récupérer au plus (INT_MAX pour tout récupérer).
+ * @return Le nombre d'entrées récupérées.
+ */
+int reclaim_orphans(partition_t *part, int budget) {
+    int *freed = NULL;
+    int num_freed = 0, freed_cap = 0;
+    int done = 0;
+
+    while (done < budget && (part->reclaim_depth > 0 || part->superblock->orphan_count > 0)) {
+        if (part->reclaim_depth == 0 &&
+            reclaim_push(part, part->superblock->orphans[part->superblock->orphan_count - 1], -1) != 0) {
+            break;  // Mémoire insuffisante: on réessaiera plus tard
+        }
+
+        // Lire le répertoire du sommet jusqu'au premier sous-répertoire
+        reclaim_frame_t *frame = &part->reclaim_stack[part->reclaim_depth - 1];
+        int dir = frame->dir;
+        int child = -1, child_pos = -1;
+        block_map_cache_t cache = BLOCK_MAP_CACHE_INIT;
+        while (frame->block < part->inodes[dir].dir_blocks && child == -1 && done < budget) {
+            int block_num = inode_bmap(part, dir, frame->block, 0, &cache);
+            if (block_num != -1) {
+                char *block = block_ptr(part, block_num);
+                for (int off = 0; off < part->block_size && done < budget; off += dir_rec_len((dir_entry_t *)(block + off))) {
+                    dir_entry_t *entry = (dir_entry_t *)(block + off);
+                    if (entry->inode_num == 0 || strcmp(entry->name, ".") == 0 || strcmp(entry->name, "..") == 0) continue;
+
+                    if (dir_entry_type(part, entry) == DIR_FT_DIR) {
+                        // Son entrée sera effacée quand il aura été vidé
+                        child = entry->inode_num;
+                        child_pos = frame->block * part->block_size + off;
+                        break;
+                    }
+                    int inode_num = entry->inode_num;
+                    entry->inode_num = 0;
+                    if (--part->inodes[inode_num].links_count == 0) {
+                        freed_push(part, &freed, &num_freed, &freed_cap, inode_num);
+                    }
+                    done++;
+                }
+                // Un morceau interrompu reprend dans ce même bloc
+                if (child != -1 || done >= budget) break;
+            }
+            frame->block++;
+        }
+
+        if (child != -1) {
+            if (reclaim_push(part, child, child_pos) != 0) break;
+            continue;
+        }
+        if (done >= budget) break;
+
+        // Répertoire vidé: effacer son entrée dans le répertoire du dessous, puis le libérer
+        int entry_pos = frame->entry_pos;
+        part->reclaim_depth--;
+        if (part->reclaim_depth > 0) {
+            dir_entry_at(part, part->reclaim_stack[part->reclaim_depth - 1].dir, entry_pos)->inode_num = 0;
+        } else {
+            orphan_remove(part, dir);
+        }
+        freed_push(part, &freed, &num_freed, &freed_cap, dir);
+        done++;
+    }
+
+    if (num_freed > 0) {
+        free_inodes(part, freed, num_freed);
+    }
+    free(freed);
+    return done;
+}
+
+
+/**
+ * @brief Réserve une place dans la liste des orphelins du superbloc.
+ *
+ * Si la liste est pleine, les orphelins en attente sont d'abord récupérés
+ * entièrement. À appeler avant de détacher le sous-arbre: orphan_add ne peut
+ * alors plus échouer.
+ *
+ * @param part Pointeur vers la partition.
+ * @return 0 si une place est libre, -1 sinon (mémoire insuffisante pour récupérer).
+ */
+int orphan_reserve(partition_t *part) {
+    if (part->superblock->orphan_count == ORPHAN_SLOTS) {
+        reclaim_orphans(part, INT_MAX);
+    }
+    return part->superblock->orphan_count < ORPHAN_SLOTS ? 0 : -1;
+}
+
+
+/**
+ * @brief Note un sous-arbre détaché dans la liste des orphelins du superbloc.
+ *
+ * @param part Pointeur vers la partition.
+ * @param dir_inode Répertoire racine du sous-arbre, déjà retiré de son parent
+ *                  (une place a été réservée par orphan_reserve).
+ */
+void orphan_add(partition_t *part, int dir_inode) {
+    part->superblock->orphans[part->superblock->orphan_count++] = dir_inode;
+}
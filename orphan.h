@@ -0,0 +1,15 @@
+#ifndef ORPHAN_H
+#define ORPHAN_H
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include "structure.h"
+#include "block.h"
+#include "inode.h"
+#include "dir_entry.h"
+int orphan_reserve(partition_t *part);
+void orphan_add(partition_t *part, int dir_inode);
+int reclaim_orphans(partition_t *part, int budget);
+
+#endif // ORPHAN_H
@@ -56,12 +56,18 @@ int check_permission(partition_t *part, int inode_num, int perm_bit) {
  */
 
 int chmod_file(partition_t *part, const char *name, int mode) {
-    // Trouver le fichier dans le répertoire courant
-    int inode_num = find_file_in_dir(part, part->current_dir_inode, name);
-    if (inode_num == -1) {
+    // Trouver le fichier (un lien symbolique désigne sa cible)
+    nameidata_t nd;
+    int error = namei(part, name, NAMEI_FOLLOW, &nd);
+    if (error == NAMEI_ENOENT) {
         printf("Erreur: Fichier '%s' non trouve\n", name);
         return -1;
     }
+    if (error != 0) {
+        namei_perror(error, name);
+        return -1;
+    }
+    int inode_num = nd.inode;
     
     // Vérifier si l'utilisateur est le propriétaire du fichier ou root
     if (part->current_user.id != 0 && part->current_user.id != part->inodes[inode_num].uid) {
@@ -74,6 +80,7 @@ int chmod_file(partition_t *part, const char *name, int mode) {
     
     // Appliquer les nouvelles permissions (les 12 derniers bits)
     part->inodes[inode_num].mode = type_bits | (mode & 07777);
+    symlink_cache_invalidate(part);  // Les droits de traversée ont pu changer
     
     // Mettre à jour le temps de modification
     part->inodes[inode_num].ctime = time(NULL);
@@ -100,16 +107,23 @@ int chown_file(partition_t *part, const char *name, int uid, int gid) {
         return -1;
     }
     
-    // Trouver le fichier dans le répertoire courant
-    int inode_num = find_file_in_dir(part, part->current_dir_inode, name);
-    if (inode_num == -1) {
+    // Trouver le fichier (un lien symbolique désigne sa cible)
+    nameidata_t nd;
+    int error = namei(part, name, NAMEI_FOLLOW, &nd);
+    if (error == NAMEI_ENOENT) {
         printf("Erreur: Fichier '%s' non trouve\n", name);
         return -1;
     }
+    if (error != 0) {
+        namei_perror(error, name);
+        return -1;
+    }
+    int inode_num = nd.inode;
     
     // Changer le propriétaire et le groupe
     part->inodes[inode_num].uid = uid;
     part->inodes[inode_num].gid = gid;
+    symlink_cache_invalidate(part);
     
     // Mettre à jour le temps de modification
     part->inodes[inode_num].ctime = time(NULL);
@@ -135,6 +149,7 @@ int switch_user(partition_t *part, int uid, int gid) {
     part->current_user.id = uid;
     sprintf(part->current_user.name, "user%d", uid);  // Nom générique
     part->current_user.group_id = gid;
+    symlink_cache_invalidate(part);  // Les cibles ont été résolues avec les droits de l'ancien utilisateur
     
     printf("Utilisateur change: uid=%d, gid=%d\n", uid, gid);
     return 0;
@@ -1,6 +1,8 @@
 #ifndef STRUCTURE_H
 #define STRUCTURE_H
 #include <stdio.h>
+#include <stdint.h>
+#include <limits.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
@@ -9,23 +11,28 @@
 #include <signal.h>
 
 
-#define BLOCK_SIZE 512
-#define MAX_NAME_LENGTH 32
-#define MAX_BLOCKS 1024
-#define MAX_INODES 100
+// Géométrie par défaut, utilisée quand aucune géométrie n'est fournie
+#define DEFAULT_BLOCK_SIZE 512
+#define DEFAULT_NUM_BLOCKS 1024
+#define DEFAULT_NUM_INODES 100
+
+// Bornes acceptées pour une géométrie fournie à l'exécution
+#define MIN_BLOCK_SIZE 128
+#define MAX_BLOCK_SIZE 65536
+#define MIN_NUM_INODES 2
+
+#define MAX_NAME_LENGTH 256   // Nom d'une entrée de répertoire: 255 octets + '\0'
+#define USER_NAME_LENGTH 32
 #define NUM_DIRECT_BLOCKS 12  // Nombre de blocs directs par inode (comme dans Unix)
 #define INDIRECT_BLOCKS 1     // Nombre de blocs indirects par inode
-#define PARTITION_SIZE (BLOCK_SIZE * MAX_BLOCKS)
-#define SYSBLOCK 20
+#define MAX_INDIRECT_LEVEL 3  // Indirect simple, double et triple
+#define NUM_EXTENTS 7         // Nombre d'extents par inode (même place que les pointeurs de blocs)
 
-#define PARTITION_OFSET 0
-#define INODE_OFSET 5
-#define USERT_OFSET 6
-#define BLOCKB_OFSET 8
-#define INODEB_OFSET 9
-#define SUPERBLOCK_OFSET 10
-
-#define USERSAPCE_OFSET 15 
+// Numéro magique du superbloc: il change avec chaque format de sauvegarde
+#define PARTITION_MAGIC 0x1234567A            // Superbloc avec la liste des orphelins
+#define PARTITION_MAGIC_NO_ORPHANS 0x12345679  // Ancien format: géométrie variable, superbloc sans liste des orphelins
+#define PARTITION_MAGIC_BASELINE 0x12345678    // Format d'origine: disposition fixe, entrées de 36 octets
+#define SUPERBLOCK_OFSET 0    // Le superbloc est toujours le bloc 0, le reste est calculé
 
 
 
@@ -38,15 +45,52 @@
 #define COPYMODE 0
 #define MOVMODE 1
 
-// Structure pour la carte des blocs (bitmap)
+// Suppression différée (rm -rb): les sous-arbres détachés attendent dans le
+// superbloc et sont récupérés par petits morceaux entre deux commandes
+#define ORPHAN_SLOTS 16              // Sous-arbres orphelins notés au plus dans le superbloc
+#define ORPHAN_RECLAIM_BUDGET 4096   // Entrées récupérées au plus entre deux commandes
+
+// Table des fichiers ouverts (file_open / file_close)
+#define MAX_OPEN_FILES 64  // Descripteurs ouverts au plus en même temps
+#define OPEN_READ 0x1      // Ouvert en lecture
+#define OPEN_WRITE 0x2     // Ouvert en écriture
+#define OPEN_CREATE 0x4    // Créer le fichier s'il n'existe pas
+#define OPEN_APPEND 0x8    // file_write écrit toujours à la fin du fichier
+#define OPEN_TRUNC 0x10    // Vider le fichier à l'ouverture (avec OPEN_WRITE)
+
+#define CAT_IOVECS 64      // Tampons passés à writev par cat en un appel
+
+// Options de ls (combinables): parcours récursif et ordre d'affichage
+// (sans option de tri, les entrées sortent dans l'ordre du répertoire)
+#define LS_RECURSIVE 0x1   // -R
+#define LS_SORT_NAME 0x2   // -n: par nom
+#define LS_SORT_SIZE 0x4   // -S: par taille, la plus grande d'abord
+#define LS_SORT_TIME 0x8   // -t: par date de modification, la plus récente d'abord
+
+// Les bitmaps sont stockés par mots de 64 bits pour pouvoir sauter d'un coup les mots pleins
+#define BITMAP_WORD_BITS 64
+#define BITMAP_WORDS(bits) (((bits) + BITMAP_WORD_BITS - 1) / BITMAP_WORD_BITS)
+
+// Géométrie d'une partition, choisie à la création
 typedef struct {
-    unsigned char bitmap[MAX_BLOCKS-USERSAPCE_OFSET / 8 + 1];  // Chaque bit représente un bloc
-} block_bitmap_t;
+    int block_size;          // Taille d'un bloc en octets (puissance de 2)
+    int num_blocks;          // Nombre total de blocs, métadonnées comprises
+    int num_inodes;          // Nombre total d'inodes
+} partition_geometry_t;
+
+// Drapeaux d'inode (champ flags)
+#define INODE_FL_EXTENTS 0x1  // Les blocs sont décrits par des extents et non par direct_blocks
+#define INODE_FL_INLINE 0x2   // Les données sont stockées dans l'inode (inline_data), sans bloc
+#define INODE_FL_DIR_BTREE 0x4  // Répertoire: dir_index_block est la racine d'un B-arbre trié par nom
+
+// Place disponible pour les données inline: toute la zone des pointeurs de blocs
+#define INODE_INLINE_SIZE ((NUM_DIRECT_BLOCKS + MAX_INDIRECT_LEVEL) * (int)sizeof(int))
 
-// Structure pour la carte des inodes (bitmap)
+// Suite de blocs logiques contigus
 typedef struct {
-    unsigned char bitmap[MAX_INODES / 8 + 1];  // Chaque bit représente un inode
-} inode_bitmap_t;
+    int start;               // Premier bloc logique
+    int length;              // Nombre de blocs
+} extent_t;
 
 // Structure pour un inode
 typedef struct {
@@ -57,21 +101,166 @@ typedef struct {
     time_t atime;            // Temps d'accès
     time_t mtime;            // Temps de modification
     time_t ctime;            // Temps de création
-    int direct_blocks[NUM_DIRECT_BLOCKS];  // Blocs directs
-    int indirect_block;      // Bloc indirect
+    int flags;               // Drapeaux INODE_FL_*
+    int dir_index_block;     // Répertoires: racine de l'index (haché, ou B-arbre avec INODE_FL_DIR_BTREE), -1 si absent
+    int dir_blocks;          // Répertoires: blocs de fichier 0 à dir_blocks-1 alloués
+    int dir_free_hint;       // Répertoires: les blocs avant celui-ci sont pleins
+    int dir_count;           // Répertoires: nombre d'entrées ("." et ".." compris)
+    union {
+        struct {             // Sans INODE_FL_EXTENTS
+            int direct_blocks[NUM_DIRECT_BLOCKS];  // Blocs directs
+            int indirect_block;      // Bloc indirect
+            int double_indirect_block;  // Bloc de blocs indirects
+            int triple_indirect_block;  // Bloc de blocs doublement indirects
+        };
+        struct {             // Avec INODE_FL_EXTENTS
+            int extent_count;        // Nombre d'extents utilisés
+            extent_t extents[NUM_EXTENTS];  // Extents, dans l'ordre du fichier
+        };
+        char inline_data[INODE_INLINE_SIZE];  // Avec INODE_FL_INLINE
+    };
     int links_count;         // Nombre de liens
 } inode_t;
 
-// Structure pour une entrée de répertoire
+// Mémorise la dernière traduction bloc de fichier -> bloc logique d'un inode,
+// pour qu'un parcours séquentiel ne redescende pas l'arbre d'indirection à chaque bloc
+typedef struct {
+    int inode_num;           // Inode concerné, -1 si le cache est vide
+    int first;               // Premier bloc de fichier couvert par la dernière table/extent
+    int count;               // Nombre de blocs de fichier couverts
+    int table_block;         // Table d'indirection feuille (-1 pour un extent)
+    int extent_start;        // Bloc logique correspondant à first pour un extent
+} block_map_cache_t;
+
+// Cache vide, pour initialiser un block_map_cache_t local
+#define BLOCK_MAP_CACHE_INIT { .inode_num = -1 }
+
+// Structure pour une entrée de répertoire, de longueur variable. Les entrées
+// d'un bloc se suivent et le couvrent entièrement: rec_len mène à la suivante.
+// Une entrée supprimée est fusionnée avec la précédente du bloc (la première
+// d'un bloc garde sa place avec inode_num à 0), et une insertion réutilise la
+// place libre qui suit le nom d'une entrée. Les entrées ne bougent donc jamais.
 typedef struct {
-    int inode_num;           // Numéro d'inode
-    char name[MAX_NAME_LENGTH];  // Nom du fichier/répertoire
+    int inode_num;           // Numéro d'inode, 0 si l'entrée est libre
+    uint16_t rec_len;        // Taille de l'entrée jusqu'à la suivante (0 pour 65536, voir dir_rec_len)
+    uint8_t name_len;        // Longueur du nom, sans le '\0'
+    uint8_t file_type;       // Type de fichier (DIR_FT_*)
+    char name[];             // Nom du fichier/répertoire, terminé par '\0'
 } dir_entry_t;
 
+// Taille minimale d'une entrée portant un nom de n octets (alignée sur 4 octets)
+#define DIR_REC_LEN(n) ((int)((sizeof(dir_entry_t) + (n) + 1 + 3) & ~3))
+
+// Types de fichier stockés dans les entrées
+#define DIR_FT_UNKNOWN 0
+#define DIR_FT_REG 1
+#define DIR_FT_DIR 2
+#define DIR_FT_SYMLINK 7
+
+// Ancien format des entrées (PARTITION_MAGIC_BASELINE), lu au chargement
+#define DIR_FIXED_NAME_LENGTH 32
+typedef struct {
+    int inode_num;           // Numéro d'inode, 0 si l'entrée est libre
+    char name[DIR_FIXED_NAME_LENGTH];  // Nom terminé par '\0'
+} dir_entry_fixed_t;
+
+// Fichier du format d'origine: les dix premiers champs de superblock_t, le
+// bitmap des blocs, celui des inodes, la table d'inodes (inode_baseline_t),
+// puis l'espace complet, dont les blocs de données commencent au bloc
+// BASELINE_FIRST_DATA_BLOCK. Les numéros de blocs des inodes sont relatifs à ce bloc.
+#define BASELINE_BLOCK_SIZE 512
+#define BASELINE_NUM_BLOCKS 1024
+#define BASELINE_NUM_INODES 100
+#define BASELINE_FIRST_DATA_BLOCK 15
+#define BASELINE_BLOCK_BITMAP_BYTES 1024  // Taille du bitmap des blocs dans le fichier
+#define BASELINE_INODE_BITMAP_BYTES (BASELINE_NUM_INODES / 8 + 1)
+
+typedef struct {
+    int mode;
+    int uid;
+    int gid;
+    int size;
+    time_t atime;
+    time_t mtime;
+    time_t ctime;
+    int direct_blocks[NUM_DIRECT_BLOCKS];
+    int indirect_block;      // Table de BASELINE_BLOCK_SIZE / sizeof(int) blocs, -1 pour un trou
+    int links_count;
+} inode_baseline_t;
+
+// Index haché d'un répertoire: table à adressage ouvert répartie sur des pages
+// (blocs). Le bloc racine liste des tables de pages, qui listent les pages.
+// Une case pointe vers la position d'une entrée (bloc de fichier du
+// répertoire * taille de bloc + décalage de l'entrée dans le bloc).
+#define DIR_INDEX_EMPTY 0        // Case jamais utilisée: fin de la recherche
+#define DIR_INDEX_DELETED -1     // Case d'une entrée supprimée: la recherche continue
+
+typedef struct {
+    uint32_t hash;           // Hash du nom de l'entrée
+    int pos;                 // Position de l'entrée + 1, ou DIR_INDEX_EMPTY/DIR_INDEX_DELETED
+} dir_index_slot_t;
+
+typedef struct {
+    int num_slots;           // Nombre de cases (puissance de 2)
+    int used;                // Cases occupées par une entrée
+    int deleted;             // Cases DIR_INDEX_DELETED
+    int num_pages;           // Nombre de pages de cases
+    int num_tables;          // Nombre de tables de pages
+    int tables[];            // Blocs logiques des tables de pages
+} dir_index_root_t;
+
+// B-arbre d'un répertoire trié (INODE_FL_DIR_BTREE), un nœud par bloc. Les
+// feuilles associent chaque nom à la position de son entrée et sont chaînées
+// dans l'ordre des noms. Les clés sont rangées depuis la fin du bloc; slots[]
+// donne leurs décalages dans l'ordre des noms, pour une recherche dichotomique.
+typedef struct {
+    int leaf;                // 1 pour une feuille
+    int count;               // Nombre de clés
+    int heap;                // Décalage de la clé la plus basse dans le bloc
+    int next;                // Feuilles: feuille suivante dans l'ordre des noms, -1 pour la dernière
+    int child0;              // Nœuds internes: enfant des noms inférieurs à la première clé
+    uint16_t slots[];        // Décalage de chaque clé, dans l'ordre des noms
+} dir_btree_node_t;
+
+typedef struct {
+    int value;               // Feuilles: position de l'entrée; nœuds internes: enfant des noms >= cette clé
+    uint8_t len;             // Longueur du nom
+    char name[];             // Nom, sans '\0'
+} dir_btree_key_t;
+
+// Place occupée par une clé de n octets de nom (arrondie à 4 octets)
+#define DIR_BTREE_KEY_SIZE(n) ((int)((sizeof(int) + 1 + (n) + 3) & ~3))
+
+// Cache des noms (dentry cache) en mémoire: (répertoire, nom) -> inode,
+// y compris les noms absents (entrées négatives). Table à correspondance directe.
+#define DCACHE_SIZE 1024         // Nombre de cases (puissance de 2)
+
+typedef struct {
+    int parent;              // Inode du répertoire, -1 si la case est vide
+    int inode_num;           // Inode trouvé, -1 pour une entrée négative
+    char name[MAX_NAME_LENGTH];  // Nom cherché dans parent
+} dentry_t;
+
+// Cible résolue de chaque lien symbolique. Elle reste valable tant que la
+// génération de la partition n'a pas changé: toute suppression ou tout
+// déplacement de nom et tout changement de droits ou d'utilisateur l'incrémente.
+typedef struct {
+    int dir;                 // Répertoire d'où la cible a été résolue, -1 si la case est vide
+    int target;              // Inode désigné par la cible
+    uint64_t generation;     // Génération de la partition lors de la résolution
+} symlink_cache_t;
+
+// Cache du parent de chaque répertoire, pour reconstruire un chemin sans
+// relire les répertoires (voir get_current_path)
+typedef struct {
+    int parent;              // Inode du répertoire parent, -1 si inconnu
+    int pos;                 // Position de l'entrée du répertoire dans son parent
+} dir_parent_t;
+
 // Structure pour représenter un utilisateur
 typedef struct {
     int id;
-    char name[MAX_NAME_LENGTH];
+    char name[USER_NAME_LENGTH];
     int group_id;
 } user_t;
 
@@ -87,33 +276,145 @@ typedef struct {
     int inodes_per_group;    // Inodes par groupe
     int free_blocks_count;   // Nombre de blocs libres
     int free_inodes_count;   // Nombre d'inodes libres
+    int block_bitmap_block;  // Premier bloc du bitmap des blocs
+    int inode_bitmap_block;  // Premier bloc du bitmap des inodes (puis son summary)
+    int inode_table_block;   // Premier bloc de la table d'inodes
+    int orphan_count;        // Sous-arbres détachés pas encore récupérés
+    int orphans[ORPHAN_SLOTS];  // Répertoire racine de chacun de ces sous-arbres
 } superblock_t;
 
 typedef struct espace_utilisable_t {
-    char data[PARTITION_SIZE];  // Données stockées sur la partition
+    size_t size;             // Taille de data en octets (num_blocks * block_size)
+    char data[];             // Données stockées sur la partition
 } espace_utilisable_t; 
 
 
+// Lot de blocs libérés (voir block_batch_begin): free_block les note ici et
+// block_batch_end les rend au bitmap en une passe
+typedef struct {
+    int *blocks;             // Blocs logiques libérés
+    int count;               // Nombre de blocs notés
+    int capacity;            // Taille allouée de blocks
+} block_batch_t;
+
+// Répertoire en cours de récupération dans un sous-arbre orphelin. Les
+// répertoires de la pile descendent de l'orphelin, du plus haut au plus profond.
+typedef struct {
+    int dir;                 // Inode du répertoire
+    int block;               // Bloc de fichier où reprendre la lecture
+    int entry_pos;           // Position de son entrée dans le répertoire du dessous, -1 pour l'orphelin
+} reclaim_frame_t;
+
+// Fichier ouvert. Le chemin est résolu et les droits vérifiés une seule fois,
+// à l'ouverture: les lectures et écritures ne repassent ni par namei ni par
+// check_permission, et gardent la traduction de blocs d'un appel à l'autre.
+typedef struct {
+    int flags;               // OPEN_* accordés à l'ouverture, 0 pour un descripteur libre
+    int inode_num;           // Inode ouvert, -1 s'il a été libéré depuis l'ouverture
+    int offset;              // Position courante (file_read, et file_write sans OPEN_APPEND)
+    uint64_t map_generation; // Valeur de map_generation quand cache a été rempli
+    block_map_cache_t cache; // Dernière traduction bloc de fichier -> bloc logique
+} file_handle_t;
+
 // Structure pour représenter la partition
 typedef struct {
     superblock_t *superblock;         // Pointeur vers le superbloc
-    block_bitmap_t *block_bitmap;     // Pointeur vers le bitmap des blocs
-    inode_bitmap_t *inode_bitmap;     // Pointeur vers le bitmap des inodes
+    uint64_t *block_bitmap;           // Pointeur vers le bitmap des blocs
+    uint64_t *inode_bitmap;           // Pointeur vers le bitmap des inodes
+    uint64_t *inode_summary;          // Bit w à 1 si inode_bitmap[w] a un inode libre
     inode_t *inodes;                  // Pointeur vers la table d'inodes
     espace_utilisable_t *space;       // Pointeur vers les données stockées
+    int block_size;                   // Géométrie, recopiée du superbloc
+    int num_blocks;
+    int num_inodes;
+    int first_data_block;             // Bloc physique du bloc logique 0
     int current_dir_inode;            // Inode du répertoire courant
+    int next_free_block;              // Curseur next-fit: bloc où reprendre la recherche
+    block_batch_t *block_batch;       // Lot de libérations en cours, NULL hors d'un lot
+    reclaim_frame_t *reclaim_stack;   // Récupération en cours d'un orphelin, non sauvegardée
+    int reclaim_depth;                // Hauteur de reclaim_stack (0: rien en cours)
+    int reclaim_capacity;             // Taille allouée de reclaim_stack
+    dentry_t *dcache;                 // Cache des noms (DCACHE_SIZE cases), non sauvegardé
+    dir_parent_t *dir_parents;        // Parent et nom de chaque répertoire (num_inodes cases), non sauvegardé
+    symlink_cache_t *symlinks;        // Cible résolue de chaque lien (num_inodes cases), non sauvegardé
+    int *dir_index_retry;             // Répertoires sans index après un échec: dir_count à atteindre avant de réessayer (num_inodes cases), non sauvegardé
+    uint64_t generation;              // Génération des noms et des droits (voir symlink_cache_t)
+    file_handle_t files[MAX_OPEN_FILES];  // Fichiers ouverts de la session, non sauvegardés
+    int open_files;                   // Nombre de descripteurs utilisés dans files
+    struct dir_stream *dir_streams;   // Parcours de répertoires ouverts (voir open_directory), non sauvegardés
+    uint64_t map_generation;          // Incrémenté quand des blocs de fichier sont libérés ou réorganisés
     user_t current_user;              // Utilisateur courant
 } partition_t;
 
+// Entrée de répertoire telle que la renvoie read_directory_batch
+typedef struct {
+    char name[MAX_NAME_LENGTH];  // Nom terminé par '\0'
+    int inode_num;           // Inode de l'entrée
+    int file_type;           // Type de fichier (DIR_FT_*)
+} dir_record_t;
+
+// Parcours d'un répertoire par lots (open_directory / read_directory_batch /
+// close_directory). Le curseur désigne la prochaine entrée à lire.
+typedef struct dir_stream {
+    partition_t *part;       // Partition parcourue
+    int dir_inode;           // Répertoire parcouru, -1 s'il a été supprimé depuis l'ouverture
+    int block;               // Bloc de fichier du curseur
+    int offset;              // Décalage du curseur dans ce bloc
+    block_map_cache_t cache; // Dernière traduction de bloc, pour les lots suivants
+    uint64_t map_generation; // Valeur de map_generation quand cache a été rempli
+    struct dir_stream *next; // Parcours suivant de la partition (part->dir_streams)
+} dir_stream_t;
+
+// Entrée collectée par ls avant le tri
+typedef struct {
+    const char *name;        // Nom (dans le tableau de noms du répertoire)
+    int name_off;            // Position du nom dans ce tableau, pendant la collecte
+    int inode_num;           // Inode de l'entrée
+    int file_type;           // Type de fichier (DIR_FT_*)
+    int size;                // Taille, pour le tri -S
+    time_t mtime;            // Date de modification, pour le tri -t
+} ls_entry_t;
+
+// Sortie de ls: le listing est construit en mémoire puis écrit d'un bloc
+typedef struct {
+    char *data;              // Texte en attente d'écriture
+    size_t len;              // Octets en attente
+    size_t cap;              // Taille allouée
+    int date_valid;          // date_str correspond à date_minute
+    time_t date_minute;      // Minute de la dernière date formatée
+    char date_str[20];       // Cette date au format "AAAA-MM-JJ HH:MM"
+    int date_len;            // Longueur de date_str
+} ls_output_t;
+
 //partition globale qui vas servire a la gertion des sig
 
 
 
-// Structure pour stocker les composants d'un chemin
+// Résolution d'un chemin (namei): options
+#define NAMEI_FOLLOW 0x1         // Suivre un lien symbolique en dernier composant
+#define NAMEI_PARENT 0x2         // Le dernier composant peut manquer: seul son répertoire doit exister
+#define NAMEI_MAX_SYMLINKS 40    // Liens symboliques suivis au plus pour un chemin
+
+// Erreurs de namei
+#define NAMEI_ENOENT -1          // Un composant n'existe pas
+#define NAMEI_ENOTDIR -2         // Un composant intermédiaire n'est pas un répertoire
+#define NAMEI_EACCES -3          // Pas de droit de traversée (x) sur un répertoire du chemin
+#define NAMEI_ELOOP -4           // Boucle de liens symboliques, ou trop de liens
+#define NAMEI_ENAMETOOLONG -5    // Composant de plus de MAX_NAME_LENGTH - 1 octets
+
+// Résultat de namei
+typedef struct {
+    int inode;                   // Inode désigné, -1 s'il n'existe pas (avec NAMEI_PARENT)
+    int parent;                  // Répertoire qui contient le dernier composant
+    char name[MAX_NAME_LENGTH];  // Dernier composant, "" pour "/"
+} nameidata_t;
+
+// Liens symboliques rencontrés pendant une résolution: ceux en cours de
+// résolution forment une pile, un lien qui y figure déjà est une boucle
 typedef struct {
-    char components[MAX_NAME_LENGTH][MAX_NAME_LENGTH];
-    int num_components;
-    int is_absolute;  // 1 si le chemin commence par '/', 0 sinon
-} path_components_t;
+    int count;                   // Liens suivis depuis le début du chemin
+    int depth;                   // Hauteur de la pile
+    int stack[NAMEI_MAX_SYMLINKS];  // Inodes des liens en cours de résolution
+} namei_links_t;
 
 #endif
\ No newline at end of file